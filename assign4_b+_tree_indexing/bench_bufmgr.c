@@ -0,0 +1,946 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+
+#define BENCH_FILE "benchbuffer.bin"
+
+// access patterns of the workloads mode: uniform and Zipfian lookups, sequential scans of
+// the file, a scan looping over a quarter more pages than the pool, and Zipfian lookups
+// that update MIXED_WRITE_PERCENT of their pages
+typedef enum WorkloadPattern {
+  WL_UNIFORM = 0,
+  WL_ZIPF = 1,
+  WL_SCAN = 2,
+  WL_LOOP = 3,
+  WL_MIXED = 4
+} WorkloadPattern;
+
+static const char *workloadNames[] = { "uniform", "zipf", "scan", "loop", "mixed" };
+#define NUM_WORKLOADS (int) (sizeof(workloadNames) / sizeof(workloadNames[0]))
+#define MIXED_WRITE_PERCENT 30
+
+// strategies the workloads mode runs: every one with a built-in policy (LFU has none),
+// and the adaptive policy starting from LRU
+static const ReplacementStrategy workloadStrategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LRU_K, RS_LRU };
+static const int workloadAdaptive[] = { 0, 0, 0, 0, 1 };
+static const char *workloadStrategyNames[] = { "FIFO", "LRU", "CLOCK", "LRU-K", "ADAPT" };
+#define NUM_WORKLOAD_STRATEGIES (int) (sizeof(workloadStrategies) / sizeof(workloadStrategies[0]))
+
+// names of the BM_ArenaBacking values
+static const char *arenaBackingNames[] = { "heap", "pages", "thp", "hugetlb" };
+
+// page words read by the benchmarks end up here, so the reads are not optimized away
+static volatile long readSink;
+
+// benchmark methods
+static void benchLRU (int numFrames, int numOps);
+static void benchPins (int numFrames, int numOps, int depth);
+static void benchScan (int numFrames, int numFilePages, int numPasses);
+static void benchThreads (int maxThreads, int numFrames, int numOps, int numPartitions, int numPages);
+static void benchWriter (int numFrames, int numFilePages, int dirtyHighPercent);
+static void benchRing (int numFrames, int numFilePages, int ringFrames);
+static void benchFlush (int numFrames);
+static void benchOptimistic (int maxThreads, int numPages, int numOps);
+static void benchTier (int numFrames, int numFilePages, int numPasses);
+static double tierScan (int numFrames, int numFilePages, int numPasses, int tierBytes, BM_PoolStats *stats);
+static void benchBatch (int numFrames, int numFilePages, int numPasses, int batch);
+static double batchScan (int numFrames, int numFilePages, int numPasses, int batch, int update, BM_PoolStats *stats);
+static void benchWorkloads (int minFrames, int maxFrames, int numFilePages, int numOps, double skew);
+static void makeWorkload (WorkloadPattern pattern, int numFrames, int numFilePages, int numOps, const double *zipfCdf,
+                          PageNumber *pages, char *writes);
+static double runWorkload (int s, int numFrames, const PageNumber *pages, const char *writes, int numOps,
+                           long long *latencies, BM_PoolStats *stats);
+static int compareLatencies (const void *a, const void *b);
+static void *threadsWorker (void *arg);
+static void *readersWorker (void *arg);
+
+// helper methods
+static double elapsedNanos (struct timespec *start, struct timespec *end);
+static void usage (char *program);
+
+// main method
+int
+main (int argc, char **argv)
+{
+  char *mode = (argc > 1) ? argv[1] : "lru";
+
+  if (strcmp(mode, "lru") == 0)
+    {
+      int numFrames = (argc > 2) ? atoi(argv[2]) : 65536;
+      int numOps = (argc > 3) ? atoi(argv[3]) : 20000;
+      benchLRU(numFrames, numOps);
+    }
+  else if (strcmp(mode, "pins") == 0)
+    {
+      int numFrames = (argc > 2) ? atoi(argv[2]) : 262144;
+      int numOps = (argc > 3) ? atoi(argv[3]) : 200000;
+      int depth = (argc > 4) ? atoi(argv[4]) : 4;
+      benchPins(numFrames, numOps, depth);
+    }
+  else if (strcmp(mode, "scan") == 0)
+    {
+      int numFrames = (argc > 2) ? atoi(argv[2]) : 1024;
+      int numFilePages = (argc > 3) ? atoi(argv[3]) : 16384;
+      int numPasses = (argc > 4) ? atoi(argv[4]) : 4;
+      benchScan(numFrames, numFilePages, numPasses);
+    }
+  else if (strcmp(mode, "threads") == 0)
+    {
+      int maxThreads = (argc > 2) ? atoi(argv[2]) : 8;
+      int numFrames = (argc > 3) ? atoi(argv[3]) : 1024;
+      int numOps = (argc > 4) ? atoi(argv[4]) : 200000;
+      int numPartitions = (argc > 5) ? atoi(argv[5]) : 1;
+      int numPages = (argc > 6) ? atoi(argv[6]) : numFrames / 2;
+      benchThreads(maxThreads, numFrames, numOps, numPartitions, numPages);
+    }
+  else if (strcmp(mode, "writer") == 0)
+    {
+      int numFrames = (argc > 2) ? atoi(argv[2]) : 1024;
+      int numFilePages = (argc > 3) ? atoi(argv[3]) : 16384;
+      int dirtyHighPercent = (argc > 4) ? atoi(argv[4]) : 50;
+      benchWriter(numFrames, numFilePages, 0);
+      benchWriter(numFrames, numFilePages, dirtyHighPercent);
+    }
+  else if (strcmp(mode, "ring") == 0)
+    {
+      int numFrames = (argc > 2) ? atoi(argv[2]) : 1024;
+      int numFilePages = (argc > 3) ? atoi(argv[3]) : 16384;
+      int ringFrames = (argc > 4) ? atoi(argv[4]) : 16;
+      benchRing(numFrames, numFilePages, 0);
+      benchRing(numFrames, numFilePages, ringFrames);
+    }
+  else if (strcmp(mode, "flush") == 0)
+    {
+      int numFrames = (argc > 2) ? atoi(argv[2]) : 16384;
+      benchFlush(numFrames);
+    }
+  else if (strcmp(mode, "optimistic") == 0)
+    {
+      int maxThreads = (argc > 2) ? atoi(argv[2]) : 8;
+      int numPages = (argc > 3) ? atoi(argv[3]) : 64;
+      int numOps = (argc > 4) ? atoi(argv[4]) : 1000000;
+      benchOptimistic(maxThreads, numPages, numOps);
+    }
+  else if (strcmp(mode, "tier") == 0)
+    {
+      int numFrames = (argc > 2) ? atoi(argv[2]) : 1024;
+      int numFilePages = (argc > 3) ? atoi(argv[3]) : 4096;
+      int numPasses = (argc > 4) ? atoi(argv[4]) : 4;
+      benchTier(numFrames, numFilePages, numPasses);
+    }
+  else if (strcmp(mode, "batch") == 0)
+    {
+      int numFrames = (argc > 2) ? atoi(argv[2]) : 1024;
+      int numFilePages = (argc > 3) ? atoi(argv[3]) : 8192;
+      int numPasses = (argc > 4) ? atoi(argv[4]) : 3;
+      int batch = (argc > 5) ? atoi(argv[5]) : 32;
+      benchBatch(numFrames, numFilePages, numPasses, batch);
+    }
+  else if (strcmp(mode, "workloads") == 0)
+    {
+      int minFrames = (argc > 2) ? atoi(argv[2]) : 256;
+      int maxFrames = (argc > 3) ? atoi(argv[3]) : 4096;
+      int numFilePages = (argc > 4) ? atoi(argv[4]) : 16384;
+      int numOps = (argc > 5) ? atoi(argv[5]) : 100000;
+      double skew = (argc > 6) ? atof(argv[6]) : 0.99;
+      benchWorkloads(minFrames, maxFrames, numFilePages, numOps, skew);
+    }
+  else
+    {
+      usage(argv[0]);
+      return 1;
+    }
+
+  return 0;
+}
+
+// pin/unpin cost of LRU hits and evictions on a large pool; the page file is
+// empty so misses never reach the disk and only the bookkeeping is measured
+void
+benchLRU (int numFrames, int numOps)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  struct timespec start, end;
+  int i;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(initBufferPool(bm, BENCH_FILE, numFrames, RS_LRU, NULL));
+
+  // fill every frame once
+  for (i = 0; i < numFrames; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+
+  // hits on random resident pages reorder the LRU list
+  srand(42);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < numOps; i++)
+    {
+      CHECK(pinPage(bm, h, rand() % numFrames));
+      CHECK(unpinPage(bm, h));
+    }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("lru hit:   frames=%d ops=%d %10.1f ns/op\n", numFrames, numOps, elapsedNanos(&start, &end) / numOps);
+
+  // pages outside the pool evict the least recently used frame
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < numOps; i++)
+    {
+      CHECK(pinPage(bm, h, numFrames + i));
+      CHECK(unpinPage(bm, h));
+    }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("lru evict: frames=%d ops=%d %10.1f ns/op\n", numFrames, numOps, elapsedNanos(&start, &end) / numOps);
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  free(bm);
+  free(h);
+}
+
+// pin-heavy hits: every op pins depth random resident pages and reads a word of each,
+// like an index descent, then unpins them; FIFO keeps hits from reordering, so the cost
+// is the frame lookup, the fix count updates and the TLB and cache misses they cause
+void
+benchPins (int numFrames, int numOps, int depth)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = calloc(depth, sizeof(BM_PageHandle));
+  struct timespec start, end;
+  BM_PoolStats stats;
+  long sum = 0;
+  int i, d;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(initBufferPool(bm, BENCH_FILE, numFrames, RS_FIFO, NULL));
+
+  // fill every frame once
+  for (i = 0; i < numFrames; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+
+  srand(42);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < numOps; i++)
+    {
+      for (d = 0; d < depth; d++)
+        {
+          CHECK(pinPage(bm, &h[d], rand() % numFrames));
+          sum += *(int *) (h[d].data + (i & (PAGE_SIZE - 1) & ~3));
+        }
+      for (d = 0; d < depth; d++)
+        CHECK(unpinPage(bm, &h[d]));
+    }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  readSink = sum;
+  stats = getPoolStats(bm);
+  printf("pins: frames=%d ops=%d depth=%d arena=%s %10.1f ns/pin\n", numFrames, numOps, depth,
+         arenaBackingNames[stats.arenaBacking], elapsedNanos(&start, &end) / ((double) numOps * depth));
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  free(bm);
+  free(h);
+}
+
+// sequential scans over a file larger than the pool, every pin is a miss
+// that reads a real page (from the OS page cache after the first pass)
+void
+benchScan (int numFrames, int numFilePages, int numPasses)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  struct timespec start, end;
+  long checksum = 0;
+  int pass, i;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(openPageFile(BENCH_FILE, &fh));
+  CHECK(ensureCapacity(numFilePages, &fh));
+  CHECK(closePageFile(&fh));
+
+  CHECK(initBufferPool(bm, BENCH_FILE, numFrames, RS_FIFO, NULL));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (pass = 0; pass < numPasses; pass++)
+    for (i = 0; i < numFilePages; i++)
+      {
+        CHECK(pinPage(bm, h, i));
+        checksum += h->data[i % PAGE_SIZE];
+        CHECK(unpinPage(bm, h));
+      }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("scan miss: frames=%d pages=%d passes=%d %10.1f ns/op (checksum %ld)\n", numFrames, numFilePages,
+      numPasses, elapsedNanos(&start, &end) / ((double) numPasses * numFilePages), checksum);
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  free(bm);
+  free(h);
+}
+
+// repeated scans of a file of record-like pages larger than the pool, so every pin
+// misses: first served by the page file alone, then by a victim tier big enough for
+// the compressed file
+void
+benchTier (int numFrames, int numFilePages, int numPasses)
+{
+  SM_FileHandle fh;
+  BM_PoolStats stats;
+  char *page = calloc(PAGE_SIZE, 1);
+  double nanos;
+  int i, r;
+
+  // 64-byte records: a 'Y' tombstone flag, '|' separators, an int key and a short
+  // string padded with zeros, as record_mgr lays them out
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(openPageFile(BENCH_FILE, &fh));
+  CHECK(ensureCapacity(numFilePages, &fh));
+  for (i = 0; i < numFilePages; i++)
+    {
+      memset(page, 0, PAGE_SIZE);
+      for (r = 0; r < PAGE_SIZE / 64; r++)
+        {
+          char *record = page + r * 64;
+          int key = i * (PAGE_SIZE / 64) + r;
+          record[0] = 'Y';
+          record[1] = '|';
+          memcpy(record + 2, &key, sizeof(int));
+          record[6] = '|';
+          sprintf(record + 7, "name%d", key);
+        }
+      CHECK(writeBlock(i, &fh, page));
+    }
+  CHECK(closePageFile(&fh));
+
+  nanos = tierScan(numFrames, numFilePages, numPasses, 0, &stats);
+  printf("tier off:  frames=%d pages=%d passes=%d %10.1f ns/op reads=%lld\n", numFrames, numFilePages, numPasses,
+      nanos, stats.reads);
+  nanos = tierScan(numFrames, numFilePages, numPasses, numFilePages * (PAGE_SIZE / 2), &stats);
+  printf("tier on:   frames=%d pages=%d passes=%d %10.1f ns/op reads=%lld tier hits=%lld %.1f bytes/page\n",
+      numFrames, numFilePages, numPasses, nanos, stats.reads, stats.tierHits,
+      stats.tierPages ? (double) stats.tierBytes / stats.tierPages : 0.0);
+
+  CHECK(destroyPageFile(BENCH_FILE));
+  free(page);
+}
+
+// ns per pin of numPasses scans through a pool with the given victim tier budget
+double
+tierScan (int numFrames, int numFilePages, int numPasses, int tierBytes, BM_PoolStats *stats)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options;
+  struct timespec start, end;
+  int pass, i;
+
+  memset(&options, 0, sizeof(BM_PoolOptions));
+  options.victimTierBytes = tierBytes;
+  CHECK(initBufferPoolWithOptions(bm, BENCH_FILE, numFrames, RS_FIFO, NULL, &options));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (pass = 0; pass < numPasses; pass++)
+    for (i = 0; i < numFilePages; i++)
+      {
+        CHECK(pinPage(bm, h, i));
+        readSink += h->data[(i * 64) % PAGE_SIZE];
+        CHECK(unpinPage(bm, h));
+      }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  *stats = getPoolStats(bm);
+
+  CHECK(shutdownBufferPool(bm));
+  free(bm);
+  free(h);
+  return elapsedNanos(&start, &end) / ((double) numPasses * numFilePages);
+}
+
+// scans of a file larger than the pool that read or update every page, evicting one
+// victim per miss and batches of them
+void
+benchBatch (int numFrames, int numFilePages, int numPasses, int batch)
+{
+  SM_FileHandle fh;
+  BM_PoolStats stats;
+  double nanos;
+  int update, b;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(openPageFile(BENCH_FILE, &fh));
+  CHECK(ensureCapacity(numFilePages, &fh));
+  CHECK(closePageFile(&fh));
+
+  // one untimed pass first, so the first timed run does not pay for a cold page cache
+  batchScan(numFrames, numFilePages, 1, 1, 0, &stats);
+  for (update = 0; update < 2; update++)
+    for (b = 1; b <= batch; b = (b == 1 && batch > 1) ? batch : batch + 1)
+      {
+        nanos = batchScan(numFrames, numFilePages, numPasses, b, update, &stats);
+        printf("%s batch=%-3d frames=%d pages=%d passes=%d %10.1f ns/op writes=%lld batches=%lld\n",
+            update ? "update:" : "read:  ", b, numFrames, numFilePages, numPasses, nanos, stats.writes,
+            stats.victimBatches);
+      }
+
+  CHECK(destroyPageFile(BENCH_FILE));
+}
+
+// ns per pin of numPasses scans through a pool with the given evictionBatch, marking
+// every page dirty if update is set
+double
+batchScan (int numFrames, int numFilePages, int numPasses, int batch, int update, BM_PoolStats *stats)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options;
+  struct timespec start, end;
+  int pass, i;
+
+  memset(&options, 0, sizeof(BM_PoolOptions));
+  options.evictionBatch = batch;
+  CHECK(initBufferPoolWithOptions(bm, BENCH_FILE, numFrames, RS_LRU, NULL, &options));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (pass = 0; pass < numPasses; pass++)
+    for (i = 0; i < numFilePages; i++)
+      {
+        CHECK(pinPage(bm, h, i));
+        if (update)
+          {
+            h->data[(i * 64) % PAGE_SIZE]++;
+            CHECK(markDirty(bm, h));
+          }
+        else
+          readSink += h->data[(i * 64) % PAGE_SIZE];
+        CHECK(unpinPage(bm, h));
+      }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  *stats = getPoolStats(bm);
+
+  CHECK(shutdownBufferPool(bm));
+  free(bm);
+  free(h);
+  return elapsedNanos(&start, &end) / ((double) numPasses * numFilePages);
+}
+
+// every access pattern against every strategy at pool sizes doubling from minFrames up
+// to maxFrames, over a file of numFilePages pages: hit ratio, throughput, and the median
+// and 99th percentile time of one pin, update and unpin. Each strategy replays the same
+// ops on a fresh pool, once untimed for the throughput and once with a clock read
+// around every op for the percentiles
+void
+benchWorkloads (int minFrames, int maxFrames, int numFilePages, int numOps, double skew)
+{
+  PageNumber *pages = malloc(numOps * sizeof(PageNumber));
+  char *writes = malloc(numOps);
+  long long *latencies = malloc(numOps * sizeof(long long));
+  double *zipfCdf = malloc(numFilePages * sizeof(double));
+  SM_FileHandle fh;
+  BM_PoolStats stats;
+  double sum = 0.0, nanos;
+  int w, s, i, numFrames;
+
+  if (minFrames < 1)
+    minFrames = 1;
+  if (maxFrames < minFrames)
+    maxFrames = minFrames;
+
+  // page i is the (i + 1)th most popular one, with weight 1 / (i + 1)^skew
+  for (i = 0; i < numFilePages; i++)
+    zipfCdf[i] = (sum += 1.0 / pow(i + 1, skew));
+  for (i = 0; i < numFilePages; i++)
+    zipfCdf[i] /= sum;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(openPageFile(BENCH_FILE, &fh));
+  CHECK(ensureCapacity(numFilePages, &fh));
+  CHECK(closePageFile(&fh));
+
+  printf("hit ratio and kops/s: replay without per-op timing; p50/p99: second replay on a fresh pool,\n"
+         "with a clock read around every op\n\n");
+  for (w = 0; w < NUM_WORKLOADS; w++)
+    {
+      printf("%s: pages=%d ops=%d", workloadNames[w], numFilePages, numOps);
+      if (w == WL_ZIPF || w == WL_MIXED)
+        printf(" skew=%.2f", skew);
+      if (w == WL_MIXED)
+        printf(" writes=%d%%", MIXED_WRITE_PERCENT);
+      printf("\n%8s %-8s %9s %9s | %8s %8s\n", "frames", "strategy", "hit ratio", "kops/s", "p50 ns", "p99 ns");
+
+      for (numFrames = minFrames; ; numFrames = (numFrames * 2 < maxFrames) ? numFrames * 2 : maxFrames)
+        {
+          makeWorkload(w, numFrames, numFilePages, numOps, zipfCdf, pages, writes);
+          for (s = 0; s < NUM_WORKLOAD_STRATEGIES; s++)
+            {
+              nanos = runWorkload(s, numFrames, pages, writes, numOps, NULL, &stats);
+              runWorkload(s, numFrames, pages, writes, numOps, latencies, NULL);
+              qsort(latencies, numOps, sizeof(long long), compareLatencies);
+              printf("%8d %-8s %9.4f %9.1f | %8lld %8lld\n", numFrames, workloadStrategyNames[s],
+                  (double) stats.hits / (stats.hits + stats.misses), numOps / nanos * 1e6,
+                  latencies[numOps / 2], latencies[(int) (numOps * 0.99)]);
+            }
+          if (numFrames == maxFrames)
+            break;
+        }
+      printf("\n");
+    }
+
+  CHECK(destroyPageFile(BENCH_FILE));
+  free(pages);
+  free(writes);
+  free(latencies);
+  free(zipfCdf);
+}
+
+// the pages and update flags of numOps ops of an access pattern
+void
+makeWorkload (WorkloadPattern pattern, int numFrames, int numFilePages, int numOps, const double *zipfCdf,
+              PageNumber *pages, char *writes)
+{
+  unsigned int seed = 42;
+  int loopPages = numFrames + numFrames / 4;
+  int i;
+
+  if (loopPages > numFilePages)
+    loopPages = numFilePages;
+
+  for (i = 0; i < numOps; i++)
+    {
+      writes[i] = 0;
+      switch (pattern)
+        {
+        case WL_UNIFORM:
+          pages[i] = rand_r(&seed) % numFilePages;
+          break;
+        case WL_SCAN:
+          pages[i] = i % numFilePages;
+          break;
+        case WL_LOOP:
+          pages[i] = i % loopPages;
+          break;
+        case WL_ZIPF:
+        case WL_MIXED:
+          {
+            // first page whose cumulative probability reaches a uniform draw
+            double u = (double) rand_r(&seed) / RAND_MAX;
+            int low = 0, high = numFilePages - 1;
+            while (low < high)
+              {
+                int mid = (low + high) / 2;
+                if (zipfCdf[mid] < u)
+                  low = mid + 1;
+                else
+                  high = mid;
+              }
+            pages[i] = low;
+            writes[i] = pattern == WL_MIXED && rand_r(&seed) % 100 < MIXED_WRITE_PERCENT;
+          }
+          break;
+        }
+    }
+}
+
+// replay the ops on a fresh pool of the s-th workload strategy; fills latencies with the
+// time of each op if it is not NULL, and stats if that is not NULL. Returns the total
+// time in nanoseconds
+double
+runWorkload (int s, int numFrames, const PageNumber *pages, const char *writes, int numOps,
+             long long *latencies, BM_PoolStats *stats)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options;
+  struct timespec start, end, opStart, opEnd;
+  long sum = 0;
+  int i;
+
+  memset(&options, 0, sizeof(BM_PoolOptions));
+  options.adaptivePolicy = workloadAdaptive[s];
+  CHECK(initBufferPoolWithOptions(bm, BENCH_FILE, numFrames, workloadStrategies[s], NULL, &options));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < numOps; i++)
+    {
+      if (latencies != NULL)
+        clock_gettime(CLOCK_MONOTONIC, &opStart);
+      CHECK(pinPage(bm, h, pages[i]));
+      sum += h->data[(i * 64) % PAGE_SIZE];
+      if (writes[i])
+        {
+          h->data[(i * 64) % PAGE_SIZE]++;
+          CHECK(markDirty(bm, h));
+        }
+      CHECK(unpinPage(bm, h));
+      if (latencies != NULL)
+        {
+          clock_gettime(CLOCK_MONOTONIC, &opEnd);
+          latencies[i] = (long long) elapsedNanos(&opStart, &opEnd);
+        }
+    }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  readSink = sum;
+  if (stats != NULL)
+    *stats = getPoolStats(bm);
+
+  CHECK(shutdownBufferPool(bm));
+  free(bm);
+  free(h);
+  return elapsedNanos(&start, &end);
+}
+
+int
+compareLatencies (const void *a, const void *b)
+{
+  long long x = *(const long long *) a;
+  long long y = *(const long long *) b;
+  return (x > y) - (x < y);
+}
+
+// updates of pages spread over a file larger than the pool with one dirty page in
+// four; without the background writer every dirty victim is written inside pinPage
+void
+benchWriter (int numFrames, int numFilePages, int dirtyHighPercent)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { 1, dirtyHighPercent };
+  SM_FileHandle fh;
+  struct timespec start, end;
+  unsigned int seed = 42;
+  int i;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(openPageFile(BENCH_FILE, &fh));
+  CHECK(ensureCapacity(numFilePages, &fh));
+  CHECK(closePageFile(&fh));
+
+  CHECK(initBufferPoolWithOptions(bm, BENCH_FILE, numFrames, RS_LRU, NULL, &options));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < numFilePages; i++)
+    {
+      CHECK(pinPage(bm, h, rand_r(&seed) % numFilePages));
+      if (i % 4 == 0)
+        {
+          h->data[0]++;
+          CHECK(markDirty(bm, h));
+        }
+      CHECK(unpinPage(bm, h));
+    }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("writer: frames=%d pages=%d high=%d%% %10.1f ns/op (%d writes)\n", numFrames, numFilePages,
+      dirtyHighPercent, elapsedNanos(&start, &end) / numFilePages, getNumWriteIO(bm));
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  free(bm);
+  free(h);
+}
+
+// a sequential scan over a file much larger than the pool mixed with lookups of a hot
+// set of half the pool; without a ring (ringFrames 0) the scan flushes the hot set
+void
+benchRing (int numFrames, int numFilePages, int ringFrames)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_AccessRing ring;
+  SM_FileHandle fh;
+  struct timespec start, end;
+  unsigned int seed = 42;
+  int numHot = numFrames / 2;
+  int i, hotReads;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(openPageFile(BENCH_FILE, &fh));
+  CHECK(ensureCapacity(numFilePages, &fh));
+  CHECK(closePageFile(&fh));
+
+  CHECK(initBufferPool(bm, BENCH_FILE, numFrames, RS_LRU, NULL));
+  for (i = 0; i < numHot; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  if (ringFrames > 0)
+    CHECK(initAccessRing(bm, &ring, ringFrames));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = numHot; i < numFilePages; i++)
+    {
+      if (ringFrames > 0)
+        {
+          CHECK(pinPageInRing(bm, &ring, h, i));
+        }
+      else
+        {
+          CHECK(pinPage(bm, h, i));
+        }
+      CHECK(unpinPage(bm, h));
+
+      CHECK(pinPage(bm, h, rand_r(&seed) % numHot));
+      CHECK(unpinPage(bm, h));
+    }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  hotReads = getNumReadIO(bm) - numFilePages;
+  printf("ring: frames=%d pages=%d ring=%d %10.1f ns/op, hot set misses %d of %d lookups\n", numFrames,
+      numFilePages, ringFrames, elapsedNanos(&start, &end) / (2.0 * (numFilePages - numHot)), hotReads,
+      numFilePages - numHot);
+
+  if (ringFrames > 0)
+    CHECK(freeAccessRing(&ring));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  free(bm);
+  free(h);
+}
+
+// time forceFlushPool and shutdownBufferPool on a pool whose frames were all dirtied
+// in random page order, starting from an empty file
+void
+benchFlush (int numFrames)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  struct timespec start, end;
+  unsigned int seed = 42;
+  int *order = malloc(numFrames * sizeof(int));
+  int pass, i, j, tmp;
+
+  for (i = 0; i < numFrames; i++)
+    order[i] = i;
+  for (i = numFrames - 1; i > 0; i--)
+    {
+      j = rand_r(&seed) % (i + 1);
+      tmp = order[i];
+      order[i] = order[j];
+      order[j] = tmp;
+    }
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(initBufferPool(bm, BENCH_FILE, numFrames, RS_LRU, NULL));
+  for (pass = 0; pass < 2; pass++)
+    {
+      for (i = 0; i < numFrames; i++)
+        {
+          CHECK(pinPage(bm, h, order[i]));
+          h->data[pass] = 'x';
+          CHECK(markDirty(bm, h));
+          CHECK(unpinPage(bm, h));
+        }
+
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      if (pass == 0)
+        {
+          CHECK(forceFlushPool(bm));
+        }
+      else
+        {
+          CHECK(shutdownBufferPool(bm));
+        }
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      printf("flush: frames=%d %-18s %10.2f ms\n", numFrames, pass == 0 ? "forceFlushPool" : "shutdownBufferPool",
+          elapsedNanos(&start, &end) / 1e6);
+    }
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  free(order);
+  free(bm);
+  free(h);
+}
+
+typedef struct ThreadsWorkerArgs {
+  BM_BufferPool *bm;
+  int numPages;
+  int numOps;
+  unsigned int seed;
+  bool optimistic;
+} ThreadsWorkerArgs;
+
+// pin/unpin throughput of 1, 2, 4, ... threads sharing one (optionally partitioned)
+// pool; every thread takes shared latches on random pages of the working set, with one
+// write in eight. The default working set of half the pool stays resident however pages
+// hash to partitions; a larger one makes the threads miss and write back dirty victims
+void
+benchThreads (int maxThreads, int numFrames, int numOps, int numPartitions, int numPages)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  pthread_t *threads = malloc(maxThreads * sizeof(pthread_t));
+  ThreadsWorkerArgs *args = malloc(maxThreads * sizeof(ThreadsWorkerArgs));
+  BM_PoolOptions options = { numPartitions };
+  struct timespec start, end;
+  int numThreads, t, i;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(initBufferPoolWithOptions(bm, BENCH_FILE, numFrames, RS_LRU, NULL, &options));
+  for (i = 0; i < numPages && i < numFrames; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+
+  for (numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+    {
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for (t = 0; t < numThreads; t++)
+        {
+          args[t] = (ThreadsWorkerArgs) { bm, numPages, numOps, t + 1, FALSE };
+          pthread_create(&threads[t], NULL, threadsWorker, &args[t]);
+        }
+      for (t = 0; t < numThreads; t++)
+        pthread_join(threads[t], NULL);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+
+      printf("threads: threads=%d frames=%d pages=%d partitions=%d %10.2f Mops/s\n", numThreads, numFrames, numPages, numPartitions,
+          (double) numThreads * numOps * 1e3 / elapsedNanos(&start, &end));
+    }
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  free(threads);
+  free(args);
+  free(bm);
+  free(h);
+}
+
+void *
+threadsWorker (void *arg)
+{
+  ThreadsWorkerArgs *args = (ThreadsWorkerArgs *) arg;
+  BM_PageHandle h;
+  int i;
+
+  for (i = 0; i < args->numOps; i++)
+    {
+      int pageNum = rand_r(&args->seed) % args->numPages;
+
+      if (i % 8 == 0)
+        {
+          CHECK(pinPageExclusive(args->bm, &h, pageNum));
+          h.data[0]++;
+          CHECK(markDirty(args->bm, &h));
+        }
+      else
+        CHECK(pinPageShared(args->bm, &h, pageNum));
+      CHECK(unpinPageLatched(args->bm, &h));
+    }
+
+  return NULL;
+}
+
+// read throughput of 1, 2, 4, ... threads on a small set of hot pages, reading a
+// record-sized slice under a shared latch and then with readPageOptimistic
+void
+benchOptimistic (int maxThreads, int numPages, int numOps)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  pthread_t *threads = malloc(maxThreads * sizeof(pthread_t));
+  ThreadsWorkerArgs *args = malloc(maxThreads * sizeof(ThreadsWorkerArgs));
+  struct timespec start, end;
+  int numThreads, optimistic, t, i;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(initBufferPool(bm, BENCH_FILE, numPages, RS_LRU, NULL));
+  for (i = 0; i < numPages; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+
+  for (optimistic = 0; optimistic < 2; optimistic++)
+    for (numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+      {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (t = 0; t < numThreads; t++)
+          {
+            args[t] = (ThreadsWorkerArgs) { bm, numPages, numOps, t + 1, optimistic };
+            pthread_create(&threads[t], NULL, readersWorker, &args[t]);
+          }
+        for (t = 0; t < numThreads; t++)
+          pthread_join(threads[t], NULL);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        printf("optimistic: %-10s threads=%d pages=%d %10.2f Mops/s\n", optimistic ? "optimistic" : "shared",
+            numThreads, numPages, (double) numThreads * numOps * 1e3 / elapsedNanos(&start, &end));
+      }
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  free(threads);
+  free(args);
+  free(bm);
+  free(h);
+}
+
+void *
+readersWorker (void *arg)
+{
+  ThreadsWorkerArgs *args = (ThreadsWorkerArgs *) arg;
+  BM_OptimisticHandle optimistic = INIT_OPTIMISTIC_HANDLE;
+  BM_PageHandle h;
+  char record[64];
+  int i;
+
+  for (i = 0; i < args->numOps; i++)
+    {
+      int pageNum = rand_r(&args->seed) % args->numPages;
+
+      if (args->optimistic)
+        {
+          CHECK(readPageOptimistic(args->bm, &optimistic, pageNum, record, 128, sizeof(record)));
+        }
+      else
+        {
+          CHECK(pinPageShared(args->bm, &h, pageNum));
+          memcpy(record, h.data + 128, sizeof(record));
+          CHECK(unpinPageLatched(args->bm, &h));
+        }
+    }
+
+  return NULL;
+}
+
+double
+elapsedNanos (struct timespec *start, struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+void
+usage (char *program)
+{
+  printf("usage: %s lru [frames] [ops]\n", program);
+  printf("       %s pins [frames] [ops] [depth]\n", program);
+  printf("       %s scan [frames] [file pages] [passes]\n", program);
+  printf("       %s threads [max threads] [frames] [ops per thread] [partitions] [pages]\n", program);
+  printf("       %s writer [frames] [file pages] [dirty high %%]\n", program);
+  printf("       %s ring [frames] [file pages] [ring frames]\n", program);
+  printf("       %s flush [frames]\n", program);
+  printf("       %s optimistic [max threads] [pages] [ops per thread]\n", program);
+  printf("       %s tier [frames] [file pages] [passes]\n", program);
+  printf("       %s batch [frames] [file pages] [passes] [batch]\n", program);
+  printf("       %s workloads [min frames] [max frames] [file pages] [ops] [zipf skew]\n", program);
+}
@@ -0,0 +1,233 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_FILE "bmsimbuffer.bin"
+#define SIM_MIN_FRAMES 4
+
+// replacement strategies the buffer manager implements, alone, behind the TinyLFU
+// admission filter, and the adaptive policy starting from LRU, in the order of the columns
+static const ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LRU_K, RS_FIFO, RS_LRU, RS_LRU };
+static const int admission[] = { 0, 0, 0, 0, 1, 1, 0 };
+static const int adaptive[] = { 0, 0, 0, 0, 0, 0, 1 };
+static const char *strategyNames[] = { "FIFO", "LRU", "CLOCK", "LRU-K", "FIFO+A", "LRU+A", "ADAPT" };
+#define NUM_STRATEGIES (int) (sizeof(strategies) / sizeof(strategies[0]))
+
+// a trace with its (file, page) keys renumbered densely from 0, so every trace
+// replays against one page file
+typedef struct SimTrace {
+  int numRecords;
+  int *pages;
+  char *ops;
+  int numPages;
+  int numPins;
+} SimTrace;
+
+// open-addressing table from (file, page) to the dense page number
+typedef struct PageIds {
+  long long *keys;
+  int *ids;
+  int capacity;
+  int count;
+} PageIds;
+
+// simulator methods
+static RC readTrace (char *fileName, SimTrace *trace);
+static double replay (SimTrace *trace, ReplacementStrategy strategy, int admissionFilter, int adaptivePolicy, int numFrames);
+
+// helper methods
+static int pageId (PageIds *table, long long key);
+static void usage (char *program);
+
+// main method: replay a trace written by startPoolTrace against every strategy at
+// pool sizes from min frames doubling up to max frames, and print the hit ratios
+int
+main (int argc, char **argv)
+{
+  SimTrace trace;
+  int minFrames, maxFrames, numFrames, s;
+
+  if (argc < 2)
+    {
+      usage(argv[0]);
+      return 1;
+    }
+
+  initStorageManager();
+  if (readTrace(argv[1], &trace) != RC_OK)
+    {
+      printf("%s: cannot read trace %s\n", argv[0], argv[1]);
+      return 1;
+    }
+
+  // by default up to the number of distinct pages, where only first references miss
+  minFrames = (argc > 2) ? atoi(argv[2]) : SIM_MIN_FRAMES;
+  maxFrames = (argc > 3) ? atoi(argv[3]) : trace.numPages;
+  if (minFrames < 1)
+    minFrames = 1;
+  if (maxFrames < minFrames)
+    maxFrames = minFrames;
+
+  printf("trace: %d records, %d pins, %d distinct pages\n", trace.numRecords, trace.numPins, trace.numPages);
+  printf("%8s", "frames");
+  for (s = 0; s < NUM_STRATEGIES; s++)
+    printf(" %8s", strategyNames[s]);
+  printf("\n");
+
+  for (numFrames = minFrames; ; numFrames = (numFrames * 2 < maxFrames) ? numFrames * 2 : maxFrames)
+    {
+      printf("%8d", numFrames);
+      for (s = 0; s < NUM_STRATEGIES; s++)
+        printf(" %8.4f", replay(&trace, strategies[s], admission[s], adaptive[s], numFrames));
+      printf("\n");
+      if (numFrames == maxFrames)
+        break;
+    }
+
+  free(trace.pages);
+  free(trace.ops);
+  return 0;
+}
+
+// load a trace file and renumber its pages
+RC
+readTrace (char *fileName, SimTrace *trace)
+{
+  FILE *file = fopen(fileName, "rb");
+  BM_TraceHeader header;
+  BM_TraceRecord record;
+  PageIds table = { NULL, NULL, 0, 0 };
+  int capacity = 1024;
+
+  if (file == NULL)
+    return RC_FILE_NOT_FOUND;
+  if (fread(&header, sizeof(BM_TraceHeader), 1, file) != 1 || header.magic != BM_TRACE_MAGIC
+      || header.version != BM_TRACE_VERSION)
+    {
+      fclose(file);
+      return RC_READ_NON_EXISTING_PAGE;
+    }
+
+  memset(trace, 0, sizeof(SimTrace));
+  trace->pages = malloc(capacity * sizeof(int));
+  trace->ops = malloc(capacity);
+  while (fread(&record, sizeof(BM_TraceRecord), 1, file) == 1)
+    {
+      if (trace->numRecords == capacity)
+        {
+          capacity *= 2;
+          trace->pages = realloc(trace->pages, capacity * sizeof(int));
+          trace->ops = realloc(trace->ops, capacity);
+        }
+      trace->pages[trace->numRecords] = pageId(&table, ((long long) record.fileId << 32) | (unsigned int) record.pageNum);
+      trace->ops[trace->numRecords] = record.op;
+      if (record.op == TRACE_PIN)
+        trace->numPins++;
+      trace->numRecords++;
+    }
+  fclose(file);
+
+  trace->numPages = table.count;
+  free(table.keys);
+  free(table.ids);
+  return RC_OK;
+}
+
+// hit ratio of a trace on a pool of numFrames frames; pins that find every frame
+// pinned count as misses and their unpins are skipped
+double
+replay (SimTrace *trace, ReplacementStrategy strategy, int admissionFilter, int adaptivePolicy, int numFrames)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  int *pins = calloc(trace->numPages > 0 ? trace->numPages : 1, sizeof(int));
+  BM_PoolOptions options;
+  BM_PoolStats stats;
+  int i;
+
+  // the page file stays empty, so misses never touch the disk
+  memset(&options, 0, sizeof(BM_PoolOptions));
+  options.admissionFilter = admissionFilter;
+  options.adaptivePolicy = adaptivePolicy;
+  createPageFile(SIM_FILE);
+  initBufferPoolWithOptions(bm, SIM_FILE, numFrames, strategy, NULL, &options);
+  for (i = 0; i < trace->numRecords; i++)
+    {
+      int page = trace->pages[i];
+      if (trace->ops[i] == TRACE_PIN)
+        {
+          if (pinPage(bm, h, page) == RC_OK)
+            pins[page]++;
+        }
+      else if (pins[page] > 0)
+        {
+          h->pageNum = page;
+          unpinPage(bm, h);
+          pins[page]--;
+        }
+    }
+
+  stats = getPoolStats(bm);
+  for (i = 0; i < trace->numPages; i++)
+    for (h->pageNum = i; pins[i] > 0; pins[i]--)
+      unpinPage(bm, h);
+  shutdownBufferPool(bm);
+  destroyPageFile(SIM_FILE);
+
+  free(pins);
+  free(bm);
+  free(h);
+  return (stats.hits + stats.misses) ? (double) stats.hits / (stats.hits + stats.misses) : 0.0;
+}
+
+// dense number of a key, assigned on first sight
+int
+pageId (PageIds *table, long long key)
+{
+  unsigned long long hash;
+  int i;
+
+  if (2 * (table->count + 1) > table->capacity)
+    {
+      PageIds grown = { NULL, NULL, table->capacity ? 2 * table->capacity : 1024, table->count };
+      grown.keys = malloc(grown.capacity * sizeof(long long));
+      grown.ids = malloc(grown.capacity * sizeof(int));
+      for (i = 0; i < grown.capacity; i++)
+        grown.ids[i] = -1;
+      for (i = 0; i < table->capacity; i++)
+        if (table->ids[i] >= 0)
+          {
+            hash = (unsigned long long) table->keys[i] * 0x9e3779b97f4a7c15ull;
+            int slot = (int) (hash >> 32) & (grown.capacity - 1);
+            while (grown.ids[slot] >= 0)
+              slot = (slot + 1) & (grown.capacity - 1);
+            grown.keys[slot] = table->keys[i];
+            grown.ids[slot] = table->ids[i];
+          }
+      free(table->keys);
+      free(table->ids);
+      *table = grown;
+    }
+
+  hash = (unsigned long long) key * 0x9e3779b97f4a7c15ull;
+  i = (int) (hash >> 32) & (table->capacity - 1);
+  while (table->ids[i] >= 0)
+    {
+      if (table->keys[i] == key)
+        return table->ids[i];
+      i = (i + 1) & (table->capacity - 1);
+    }
+  table->keys[i] = key;
+  table->ids[i] = table->count;
+  return table->count++;
+}
+
+void
+usage (char *program)
+{
+  printf("usage: %s trace-file [min frames] [max frames]\n", program);
+}
@@ -1,519 +1,4208 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <errno.h>
 
 #include "buffer_mgr.h"
 #include "storage_mgr.h"
 #include "dberror.h"
 
+// optimistic read attempts before readPageOptimistic falls back to a shared latch
+#define OPTIMISTIC_READ_RETRIES 8
+
+// trace records buffered in memory before they are appended to the trace file
+#define TRACE_BUFFER_RECORDS 4096
+
+// longest run of consecutive queued pages the prefetcher reads with one readBlocks call
+#define PREFETCH_BATCH_PAGES 32
+
+// first word of a warm restart file, followed by the page count and the page numbers
+#define WARM_FILE_MAGIC 0x4d524157
+
+// admission sketch: rows of the count-min sketch, saturation value of its 4-bit
+// counters (two to a byte), and counters per frame (rounded up to a power of two) and
+// recorded pins per frame before all counters are halved
+#define SKETCH_ROWS 4
+#define SKETCH_MAX_COUNT 15
+#define SKETCH_WIDTH_PER_FRAME 4
+#define SKETCH_MIN_WIDTH 64
+#define SKETCH_SAMPLE_PER_FRAME 10
+
+// protectedPercent of pools that do not set it
+#define DEFAULT_PROTECTED_PERCENT 50
+
+// victim tier: pages that compress to more than this share of PAGE_SIZE are not kept,
+// and the hash table has a bucket per this many bytes of budget
+#define TIER_MAX_COMPRESSED (PAGE_SIZE * 3 / 4)
+#define TIER_BYTES_PER_BUCKET 512
+
+// adaptive policy: shadow caches get a sixteenth of the pool's frames, at least 64 (all
+// of a smaller pool) and at most 1024, so about one pin in sixteen is simulated. An epoch
+// lasts this many sampled pins per shadow frame, and a strategy only takes over if it
+// hit this many percent of the epoch's sampled pins more than the one in use
+#define ADAPT_SHADOW_DIVISOR 16
+#define ADAPT_MIN_SHADOW_FRAMES 64
+#define ADAPT_MAX_SHADOW_FRAMES 1024
+#define ADAPT_EPOCH_PER_FRAME 8
+#define ADAPT_MIN_GAIN_PERCENT 2
+
+// waitForFrame result when the page was loaded by another thread during the wait
+#define HIT_WHILE_WAITING -2
+
+// claimFrame result when the victim's write-back failed; the victim stays dirty and buffered
+#define EVICTION_FAILED -3
+
+// claimFrame result when a dirty victim was written back without the table latch: the
+// victim is clean but still buffered, and the caller looks its page up again and retries
+#define VICTIM_WRITTEN -4
+
+// page data of at least one huge page is mapped and aligned to huge pages, smaller
+// chunks come from the heap
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
 /*******************************************
-*  Buffer Manager Interface Pool Handling       
+*  Buffer Manager Interface Pool Handling
 *******************************************/
 
+// A slice of the pool with its own frames, page table, replacement order and latch;
+// pages are spread over the partitions by a hash of their file and page number
+typedef struct PoolPartition
+{
+    // latch over this partition's page table, replacement order and frame assignment
+    pthread_mutex_t tableLatch;
+    // signalled when a frame becomes replaceable while pins wait for one
+    pthread_cond_t frameFreed;
+    int waitingPins;
+    // frames [firstFrame, firstFrame + numFrames) of the pool belong to this partition
+    int firstFrame;
+    int numFrames;
+    int availableSlots;
+    // unused frames, chained through orderNext and handed out from the head
+    int freeHead;
+    // replacement order as a list of frame indices threaded through the frames:
+    // head is the first eviction candidate, tail the most recently loaded/used
+    int orderHead;
+    int orderTail;
+    // page table: (file, page number) -> frame, buckets chained through the frames
+    int *hashBuckets;
+    int hashMask;
+    // counters of getPoolStats, summed over the partitions when read
+    long long readCount;
+    long long writeCount;
+    long long hitCount;
+    long long missCount;
+    long long pinFailures;
+    long long evictionCount;
+    long long dirtyEvictionCount;
+    long long flushCount;
+    long long pinWaitCount;
+    long long blockedPins;
+    long long blockedNanos;
+    long long pinTimeouts;
+    long long lruPromotions;
+    long long pinnedSkips;
+    long long ringRecycles;
+    long long prefetchLoads;
+    long long optimisticFallbacks;
+    long long admissionRejects;
+    long long victimBatches;
+    // buffered pages of each BM_PageClass
+    int classFrames[BM_NUM_PAGE_CLASSES];
+    // admission filter: SKETCH_ROWS rows of sketchMask + 1 4-bit pin counters, two per
+    // byte (NULL: no filter), pins recorded since the last halving, and the last page
+    // loaded on a miss while it has not been hit, which rejected pages replace
+    unsigned char *sketch;
+    int sketchMask;
+    int sketchPins;
+    int probationFrame;
+    // LRU-K: the order starts with the pages referenced once since they were loaded, up
+    // to this frame (NO_PAGE: none), followed by the pages hit since in LRU order
+    int onceTail;
+    // optimistic readers of the partition's pages that may be using a frame descriptor,
+    // by the parity of the reader epoch they entered in; on a line of their own, so
+    // readers do not contend with the table latch
+    int optimisticReaders[2] __attribute__((aligned(64)));
+} __attribute__((aligned(64))) PoolPartition;
+
+// A dirty frame picked up by the background writer
+typedef struct FlushCandidate
+{
+    int fileId;
+    PageNumber pageNum;
+    int frame;
+} FlushCandidate;
+
+// A page queued for the prefetcher
+typedef struct PrefetchRequest
+{
+    int fileId;
+    PageNumber pageNum;
+} PrefetchRequest;
+
+// A clean page evicted from the pool, compressed (see compressPage)
+typedef struct TierEntry
+{
+    int fileId;
+    PageNumber pageNum;
+    int size;
+    struct TierEntry *hashNext;
+    // neighbours in the tier's LRU list
+    struct TierEntry *lruPrev;
+    struct TierEntry *lruNext;
+    unsigned char data[];
+} TierEntry;
+
+// Second-level cache behind the frames: evicted pages, compressed, within a byte budget.
+// A page is in the frames or in the tier, never both, so the tier copy is never stale
+typedef struct VictimTier
+{
+    pthread_mutex_t latch;
+    TierEntry **buckets;
+    int bucketMask;
+    // least recently stored entry at the head, dropped first when over budget
+    TierEntry *lruHead;
+    TierEntry *lruTail;
+    long long budget;
+    long long bytes;
+    int pages;
+    long long hits;
+    long long stores;
+} VictimTier;
+
+// strategies the adaptive policy simulates, one shadow cache each
+#define ADAPT_NUM_SHADOWS 4
+
+// A simulated pool of the sampled pages under one built-in strategy: slots hold page
+// keys and are threaded into a replacement order like the frames of a partition
+typedef struct ShadowCache
+{
+    ReplacementStrategy strategy;
+    unsigned long long *keys;
+    int *hashNext;
+    int *orderPrev;
+    int *orderNext;
+    bool *referenced;
+    int *buckets;
+    int bucketMask;
+    // slots in use, ends of the order, and for LRU-K the last slot referenced only once
+    int used;
+    int head;
+    int tail;
+    int onceTail;
+    long long epochHits;
+} ShadowCache;
+
+// State of adaptivePolicy: shadow caches of capacity frames see the pins of pages whose
+// key hash falls below sampleThreshold (out of 65536); after epochLength sampled pins the
+// best strategy becomes pending, and the next pin switches the pool to it
+typedef struct AdaptiveState
+{
+    pthread_mutex_t latch;
+    ShadowCache shadows[ADAPT_NUM_SHADOWS];
+    int capacity;
+    unsigned int sampleThreshold;
+    int epochPins;
+    int epochLength;
+    int pending;
+    long long switches;
+} AdaptiveState;
+
+// A page file the pool caches pages of; frames refer to it by its index in the file table
+typedef struct PoolFile
+{
+    SM_FileHandle fileHandle;
+    char *fileName;
+    // BM_BufferPool handles attached to the file, 0 for an unused slot
+    int refCount;
+} PoolFile;
+
+// A block of frame slots allocated together: the page data and frame latches of
+// frames added by one initBufferPool/resizeBufferPool call
+typedef struct FrameChunk
+{
+    char *data;
+    // how the page data was allocated, and the length of its mapping
+    BM_ArenaBacking backing;
+    size_t mappedBytes;
+    pthread_rwlock_t *latches;
+    int numSlots;
+    // slots currently backing a frame, the chunk is freed when this drops to 0
+    int liveSlots;
+} FrameChunk;
+
 // Bufferpool
 typedef struct BufferPoolInfo
 {
-    int writeCount;
-    int *pageFixCount;
-    int *accessTimestamps;
-    int *pageNumbers;
+    // one cache-line-sized descriptor per frame (see BM_PageFrame), 64-byte aligned
+    BM_PageFrame *frames;
     int maxPages;
     int strategyType;
-    int readCount;
-    bool *dirtyFlags;
-    char *pageDataBuffer;
-    SM_FileHandle fileHandle;
-    int availableSlots;
-    int *accessOrder;
+    // replacement decisions: a caller's policy, or the built-in one of strategyType
+    BM_ReplacementPolicy policy;
+    // chunks holding the page data and latches the frame descriptors point to
+    FrameChunk *chunks;
+    int numChunks;
+    // weakest backing and total size of the chunks' page data, for getPoolStats
+    BM_ArenaBacking arenaBacking;
+    long long arenaBytes;
+    // serializes resizeBufferPool calls
+    pthread_mutex_t resizeLatch;
+    // seqlock version of the frame layout, odd while resizeBufferPool renumbers frames
+    unsigned int layoutVersion;
+    // epoch of the optimistic readers; a resize advances it and waits for the readers of
+    // the old one before it frees the frames and chunks it replaced
+    unsigned int readerEpoch;
+    // page files of the pool; a private pool has exactly one, at index 0
+    PoolFile *files;
+    int numFiles;
+    bool shared;
+    // forcePage waits for fdatasync after the write
+    bool syncOnForce;
+    // pins on a full partition wait this long for an unpin, 0: they fail right away
+    int pinTimeoutMillis;
+    // closing a page file lists its resident pages for the next open to prefetch
+    bool warmRestart;
+    long long warmPages;
+    // misses go through the TinyLFU admission filter of their partition
+    bool admissionFilter;
+    // page classes above BM_PAGE_DATA keep their eviction priority up to this share of a partition
+    int protectedPercent;
+    // victims a miss on a full partition evicts at once, 1 without batching
+    int evictionBatch;
+    // compressed cache of evicted pages, NULL if the pool has none
+    VictimTier *tier;
+    // shadow caches that pick the strategy, NULL unless adaptivePolicy is set
+    AdaptiveState *adaptive;
+    // handles attached to the pool, chained through next under the I/O latch, so a
+    // strategy switch reaches the strategy field of every BM_BufferPool
+    struct PoolHandle *handles;
+    // forcePage calls and their latency (write plus optional sync) in nanoseconds
+    long long forceCount;
+    long long forceNanosTotal;
+    long long forceNanosMax;
+    // serializes block I/O and changes of the file table between partitions
+    pthread_mutex_t ioLatch;
+    // I/O gate, under the I/O latch: frames whose I/O runs without their partition latch
+    // (they stay fixed meanwhile), and callers that need every frame settled, such as
+    // detachFile; while one of them holds the gate closed, I/O keeps the partition
+    // latch. unlatchedIoDone is signalled when the last unlatched I/O ends
+    int unlatchedIo;
+    int ioGateClosers;
+    pthread_cond_t unlatchedIoDone;
+    PoolPartition *partitions;
+    int numPartitions;
+    // background writer: woken when dirtyCount reaches dirtyHigh, flushes down to dirtyLow
+    BM_PoolOptions writerOptions;
+    int dirtyCount;
+    int dirtyHigh;
+    int dirtyLow;
+    bool writerStarted;
+    bool writerStop;
+    pthread_t writerThread;
+    pthread_mutex_t writerLatch;
+    pthread_cond_t writerWake;
+    // writer-owned scratch: flush candidates and the copy of the page being written
+    FlushCandidate *flushCandidates;
+    char *flushPage;
+    // prefetcher: a ring of requested pages, loaded by a thread started on first use
+    PrefetchRequest *prefetchQueue;
+    int prefetchHead;
+    int prefetchCount;
+    bool prefetchStarted;
+    bool prefetchStop;
+    pthread_t prefetchThread;
+    pthread_mutex_t prefetchLatch;
+    pthread_cond_t prefetchWake;
+    // pin/unpin trace: records are buffered and appended to traceFile in blocks;
+    // tracing is checked without the latch so an untraced pin only pays one load
+    bool tracing;
+    bool traceFailed;
+    FILE *traceFile;
+    BM_TraceRecord *traceBuffer;
+    int traceCount;
+    struct timespec traceStart;
+    pthread_mutex_t traceLatch;
 }BufferPoolInfo;
 
-bool isPageFound = FALSE;
+// What a BM_BufferPool points to: the pool and the file the handle reads and writes
+typedef struct PoolHandle
+{
+    BufferPoolInfo *pool;
+    int fileId;
+    // per-frame arrays returned by the statistics functions, copied out of the frame
+    // descriptors; in a shared pool only this file's frames are filled in
+    PageNumber *frameContentsView;
+    bool *dirtyFlagsView;
+    int *fixCountsView;
+    // pool size the views were allocated for
+    int viewPages;
+    // the caller's struct this handle is the mgmtData of, and the pool's next handle
+    BM_BufferPool *bufferPool;
+    struct PoolHandle *next;
+} PoolHandle;
+
+// Process-wide pool handed out by attachBufferPool, NULL until initSharedBufferPool
+static BufferPoolInfo *sharedPool;
+static int sharedPoolUsers;
+static pthread_mutex_t sharedPoolLatch = PTHREAD_MUTEX_INITIALIZER;
+
+// Pin counts are updated atomically and read without the table latch
+static inline int fixCountOf(BufferPoolInfo *bufferInfo, int frame) {
+    return __atomic_load_n(&bufferInfo->frames[frame].fixCount, __ATOMIC_ACQUIRE);
+}
+
+//  static helper methods
+
+// Allocate a cache-line-aligned array of empty frame descriptors
+static BM_PageFrame *allocFrames(int numFrames) {
+    BM_PageFrame *frames = (BM_PageFrame *)aligned_alloc(64, numFrames * sizeof(BM_PageFrame));
+    if (!frames) {
+        return NULL;
+    }
+    memset(frames, 0, numFrames * sizeof(BM_PageFrame));
+    for (int i = 0; i < numFrames; i++) {
+        frames[i].pageNumber = NO_PAGE;
+        frames[i].fileId = NO_PAGE;
+        frames[i].orderPrev = NO_PAGE;
+        frames[i].orderNext = NO_PAGE;
+        frames[i].hashNext = NO_PAGE;
+    }
+    return frames;
+}
+
+static RC createPool(const int pageCount, ReplacementStrategy strategy, const BM_ReplacementPolicy *policy,
+                     const BM_PoolOptions *options, BufferPoolInfo **poolOut);
+static RC createHandle(BM_BufferPool *const bufferPool, BufferPoolInfo *bufferInfo, int fileId, const char *const pageFileName);
+static RC attachFile(BufferPoolInfo *bufferInfo, const char *const pageFileName, int *fileIdOut);
+static RC detachFile(BufferPoolInfo *bufferInfo, int fileId);
+static RC writeDirtyPagesToDisk(BufferPoolInfo *bufferInfo, int fileId, bool unpinnedOnly);
+static RC writeSortedRuns(BufferPoolInfo *bufferInfo, const FlushCandidate *candidates, int numCandidates);
+static int compareFlushCandidates(const void *a, const void *b);
+static void releaseBufferMemory(BufferPoolInfo *bufferInfo);
+static RC initPartitions(BufferPoolInfo *bufferInfo, int numPartitions);
+static int addFrameChunk(BufferPoolInfo *bufferInfo, int numSlots);
+static void freeFrameChunk(FrameChunk *chunk);
+static unsigned int enterOptimisticRead(BufferPoolInfo *bufferInfo, PoolPartition *partition);
+static void leaveOptimisticRead(PoolPartition *partition, unsigned int epoch);
+static void waitForOptimisticReaders(BufferPoolInfo *bufferInfo);
+static RC rebuildFrames(BufferPoolInfo *bufferInfo, int newNumPages);
+static inline unsigned int pageKeyHash(int fileId, PageNumber pageNum);
+static PoolPartition *partitionOf(BufferPoolInfo *bufferInfo, int fileId, PageNumber pageNum);
+static void updateBufferStats(BufferPoolInfo *bufferPoolData, PoolPartition *partition, int bufferIndex, int fileId, int pageNumber);
+static int lookupFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int fileId, PageNumber pageNum);
+static void mapFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame);
+static void unmapFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame);
+static void appendToOrder(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame);
+static void prependToOrder(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame);
+static void unlinkFromOrder(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame);
+static void insertIntoOrder(BufferPoolInfo *bufferInfo, PoolPartition *partition, int after, int frame);
+static int findVictimFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition);
+static void releaseFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame);
+static RC pinFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int fileId, BM_PageHandle *const page, const PageNumber pageNum, int *frameOut, pthread_rwlock_t **loadLatch);
+static bool pinBufferedFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int fileId, BM_PageHandle *const page, const PageNumber pageNum, int *frameOut, pthread_rwlock_t **loadLatch);
+static void waitForLoad(pthread_rwlock_t *loadLatch);
+static int claimFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, bool mayUnlatch);
+static int chooseVictimFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition);
+static int claimVictimBatch(BufferPoolInfo *bufferInfo, PoolPartition *partition, bool mayUnlatch);
+static int claimAdmittedFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int fileId, PageNumber pageNum, bool *cold);
+static void sketchRecord(PoolPartition *partition, int fileId, PageNumber pageNum);
+static int sketchEstimate(const PoolPartition *partition, int fileId, PageNumber pageNum);
+static int waitForFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int fileId, BM_PageHandle *const page, const PageNumber pageNum, int *frameOut, pthread_rwlock_t **loadLatch);
+static void releasePin(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame);
+static RC writeBackFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame);
+static int evictFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame, bool mayUnlatch);
+static bool writeVictimUnlatched(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame, RC *status);
+static void dropVictim(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame, bool dirty);
+static void loadFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame, int fileId, BM_PageHandle *const page, const PageNumber pageNum, bool cold);
+static void installFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame, int fileId, const PageNumber pageNum, bool cold);
+static void returnClaimedFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame);
+static void setDirty(BufferPoolInfo *bufferInfo, int frame);
+static bool beginUnlatchedIo(BufferPoolInfo *bufferInfo);
+static void endUnlatchedIo(BufferPoolInfo *bufferInfo);
+static void closeIoGate(BufferPoolInfo *bufferInfo);
+static void openIoGate(BufferPoolInfo *bufferInfo);
+static void clearDirty(BufferPoolInfo *bufferInfo, int frame);
+static RC startBackgroundWriter(BufferPoolInfo *bufferInfo, const BM_PoolOptions *options);
+static void stopBackgroundWriter(BufferPoolInfo *bufferInfo);
+static void *backgroundWriter(void *arg);
+static int flushDirtyFrames(BufferPoolInfo *bufferInfo);
+static void stopPrefetcher(BufferPoolInfo *bufferInfo);
+static void *prefetcher(void *arg);
+static RC queuePrefetch(BufferPoolInfo *bufferInfo, int fileId, const PageNumber *pageNums, PageNumber startPage, int numPages);
+static void saveWarmPages(BufferPoolInfo *bufferInfo, int fileId);
+static void loadWarmPages(BufferPoolInfo *bufferInfo, int fileId);
+static void setPolicy(BufferPoolInfo *bufferInfo, const BM_ReplacementPolicy *policy);
+static VictimTier *createTier(long long budget);
+static void freeTier(VictimTier *tier);
+static void tierStore(VictimTier *tier, int fileId, PageNumber pageNum, const char *page);
+static bool tierLoad(VictimTier *tier, int fileId, PageNumber pageNum, char *page);
+static void tierDrop(VictimTier *tier, int fileId, PageNumber pageNum);
+static void tierDropFile(VictimTier *tier, int fileId);
+static AdaptiveState *createAdaptive(int numFrames);
+static void freeAdaptive(AdaptiveState *adaptive);
+static void resetAdaptive(AdaptiveState *adaptive, int numFrames);
+static void adaptiveRecord(BufferPoolInfo *bufferInfo, int fileId, PageNumber pageNum);
+static void switchPendingStrategy(BufferPoolInfo *bufferInfo);
+static void tracePage(BufferPoolInfo *bufferInfo, int fileId, PageNumber pageNum, BM_TraceOp op);
+static RC closeTrace(BufferPoolInfo *bufferInfo);
+
+// Bump one of a partition's statistics counters under its table latch; a plain
+// load and store is enough for the latch holder, readers sum them without the latch
+static inline void countEvent(long long *counter) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+}
+
+// Move a buffered page into or out of a page class count, like countEvent
+static inline void countClassFrame(PoolPartition *partition, int pageClass, int delta) {
+    __atomic_store_n(&partition->classFrames[pageClass],
+                     __atomic_load_n(&partition->classFrames[pageClass], __ATOMIC_RELAXED) + delta, __ATOMIC_RELAXED);
+}
+
+// Initialize the buffer pool
+RC initBufferPool(BM_BufferPool *const bufferPool, const char *const pageFileName, const int pageCount, ReplacementStrategy strategy, void *strategyData)
+{
+    return initBufferPoolWithOptions(bufferPool, pageFileName, pageCount, strategy, strategyData, NULL);
+}
+
+// Initialize a private buffer pool for one page file with optional settings (NULL for the defaults)
+RC initBufferPoolWithOptions(BM_BufferPool *const bufferPool, const char *const pageFileName, const int pageCount,
+                             ReplacementStrategy strategy, void *strategyData, const BM_PoolOptions *options)
+{
+    if (bufferPool == NULL || pageFileName == NULL || pageCount <= 0) {
+        return RC_ERROR;
+    }
+
+    BufferPoolInfo *bufferPoolInfo;
+    int fileId;
+
+    RC status = createPool(pageCount, strategy, (const BM_ReplacementPolicy *)strategyData, options, &bufferPoolInfo);
+    if (status != RC_OK) {
+        return status;
+    }
+
+    // Open the page file
+    status = attachFile(bufferPoolInfo, pageFileName, &fileId);
+    if (status == RC_OK) {
+        status = createHandle(bufferPool, bufferPoolInfo, fileId, pageFileName);
+    }
+    if (status != RC_OK) {
+        stopBackgroundWriter(bufferPoolInfo);
+        if (bufferPoolInfo->numFiles > 0 && bufferPoolInfo->files[0].refCount > 0) {
+            closePageFile(&bufferPoolInfo->files[0].fileHandle);
+            free(bufferPoolInfo->files[0].fileName);
+        }
+        releaseBufferMemory(bufferPoolInfo);
+        return status;
+    }
+
+    loadWarmPages(bufferPoolInfo, fileId);
+    return RC_OK;
+}
+
+// Allocate a pool without any page file
+static RC createPool(const int pageCount, ReplacementStrategy strategy, const BM_ReplacementPolicy *policy,
+                     const BM_PoolOptions *options, BufferPoolInfo **poolOut)
+{
+    BufferPoolInfo *bufferPoolInfo;
+    int i;
+    int numPartitions = (options != NULL && options->numPartitions > 0) ? options->numPartitions : 1;
+
+    // Every partition needs at least one frame
+    if (numPartitions > pageCount) {
+        numPartitions = pageCount;
+    }
+
+    // Allocate memory for the buffer pool
+    bufferPoolInfo = (BufferPoolInfo *)calloc(1, sizeof(BufferPoolInfo));
+    if (!bufferPoolInfo) {
+        return RC_MEMORY_ALLOCATION_FAIL;
+    }
+    pthread_mutex_init(&bufferPoolInfo->ioLatch, NULL);
+    pthread_cond_init(&bufferPoolInfo->unlatchedIoDone, NULL);
+    pthread_mutex_init(&bufferPoolInfo->writerLatch, NULL);
+    pthread_cond_init(&bufferPoolInfo->writerWake, NULL);
+    pthread_mutex_init(&bufferPoolInfo->prefetchLatch, NULL);
+    pthread_cond_init(&bufferPoolInfo->prefetchWake, NULL);
+    pthread_mutex_init(&bufferPoolInfo->resizeLatch, NULL);
+    pthread_mutex_init(&bufferPoolInfo->traceLatch, NULL);
+
+    bufferPoolInfo->maxPages = pageCount;
+    bufferPoolInfo->frames = allocFrames(pageCount);
+    bufferPoolInfo->strategyType = strategy;
+    setPolicy(bufferPoolInfo, policy);
+    bufferPoolInfo->syncOnForce = options != NULL && options->syncOnForce;
+    bufferPoolInfo->pinTimeoutMillis = options != NULL && options->pinTimeoutMillis > 0 ? options->pinTimeoutMillis : 0;
+    bufferPoolInfo->warmRestart = options != NULL && options->warmRestart;
+    bufferPoolInfo->admissionFilter = options != NULL && options->admissionFilter;
+    bufferPoolInfo->protectedPercent = options != NULL && options->protectedPercent > 0 ? options->protectedPercent
+                                                                                        : DEFAULT_PROTECTED_PERCENT;
+    bufferPoolInfo->evictionBatch = 1;
+    if (options != NULL && options->evictionBatch > 1 && !options->admissionFilter) {
+        bufferPoolInfo->evictionBatch = options->evictionBatch < BM_MAX_EVICTION_BATCH ? options->evictionBatch
+                                                                                       : BM_MAX_EVICTION_BATCH;
+    }
+    bufferPoolInfo->prefetchQueue = (PrefetchRequest *)malloc(pageCount * sizeof(PrefetchRequest));
+    if (options != NULL && options->victimTierBytes > 0) {
+        bufferPoolInfo->tier = createTier(options->victimTierBytes);
+    }
+    // A caller's policy stays in charge, there is nothing to switch between
+    bool adaptive = options != NULL && options->adaptivePolicy && policy == NULL;
+    if (adaptive) {
+        bufferPoolInfo->adaptive = createAdaptive(pageCount);
+    }
+
+    if (!bufferPoolInfo->frames || !bufferPoolInfo->prefetchQueue || addFrameChunk(bufferPoolInfo, pageCount) == NO_PAGE ||
+        (options != NULL && options->victimTierBytes > 0 && !bufferPoolInfo->tier) || (adaptive && !bufferPoolInfo->adaptive)) {
+        releaseBufferMemory(bufferPoolInfo);
+        return RC_MEMORY_ALLOCATION_FAIL;
+    }
+
+    // Point the empty frames at their slots in the first chunk
+    for (i = 0; i < pageCount; i++) {
+        bufferPoolInfo->frames[i].data = bufferPoolInfo->chunks[0].data + (size_t)i * PAGE_SIZE;
+        bufferPoolInfo->frames[i].latch = &bufferPoolInfo->chunks[0].latches[i];
+        bufferPoolInfo->frames[i].chunk = 0;
+    }
+
+    if (initPartitions(bufferPoolInfo, numPartitions) != RC_OK) {
+        releaseBufferMemory(bufferPoolInfo);
+        return RC_MEMORY_ALLOCATION_FAIL;
+    }
+    if (bufferPoolInfo->policy.onResize) {
+        bufferPoolInfo->policy.onResize(bufferPoolInfo->policy.state, pageCount);
+    }
+
+    // Start the background writer if a dirty watermark was given
+    if (options != NULL && options->dirtyHighPercent > 0) {
+        if (startBackgroundWriter(bufferPoolInfo, options) != RC_OK) {
+            releaseBufferMemory(bufferPoolInfo);
+            return RC_MEMORY_ALLOCATION_FAIL;
+        }
+    }
+
+    *poolOut = bufferPoolInfo;
+    return RC_OK;
+}
+
+// Split the frames into contiguous ranges, one per partition, each with its own page table
+static RC initPartitions(BufferPoolInfo *bufferInfo, int numPartitions) {
+    bufferInfo->partitions = (PoolPartition *)aligned_alloc(64, numPartitions * sizeof(PoolPartition));
+    if (!bufferInfo->partitions) {
+        return RC_MEMORY_ALLOCATION_FAIL;
+    }
+    memset(bufferInfo->partitions, 0, numPartitions * sizeof(PoolPartition));
+    bufferInfo->numPartitions = numPartitions;
+
+    int firstFrame = 0;
+    for (int p = 0; p < numPartitions; p++) {
+        PoolPartition *partition = &bufferInfo->partitions[p];
+
+        partition->firstFrame = firstFrame;
+        partition->numFrames = bufferInfo->maxPages / numPartitions + (p < bufferInfo->maxPages % numPartitions ? 1 : 0);
+        partition->availableSlots = partition->numFrames;
+        partition->orderHead = NO_PAGE;
+        partition->orderTail = NO_PAGE;
+        partition->probationFrame = NO_PAGE;
+        partition->onceTail = NO_PAGE;
+        pthread_mutex_init(&partition->tableLatch, NULL);
+        pthread_cond_init(&partition->frameFreed, NULL);
+        firstFrame += partition->numFrames;
+
+        // Free frames are handed out in frame order
+        partition->freeHead = partition->firstFrame;
+        for (int i = partition->firstFrame; i < partition->firstFrame + partition->numFrames - 1; i++) {
+            bufferInfo->frames[i].orderNext = i + 1;
+        }
+        bufferInfo->frames[partition->firstFrame + partition->numFrames - 1].orderNext = NO_PAGE;
+
+        // Size the page table to a power of two with at least two buckets per frame
+        int bucketCount = 2;
+        while (bucketCount < 2 * partition->numFrames) {
+            bucketCount <<= 1;
+        }
+        partition->hashBuckets = (int *)malloc(bucketCount * sizeof(int));
+        if (!partition->hashBuckets) {
+            return RC_MEMORY_ALLOCATION_FAIL;
+        }
+        partition->hashMask = bucketCount - 1;
+        for (int i = 0; i < bucketCount; i++) {
+            partition->hashBuckets[i] = NO_PAGE;
+        }
+
+        // The sketch keeps its size when the pool is resized
+        if (bufferInfo->admissionFilter) {
+            int width = SKETCH_MIN_WIDTH;
+            while (width < SKETCH_WIDTH_PER_FRAME * partition->numFrames) {
+                width <<= 1;
+            }
+            partition->sketch = (unsigned char *)calloc(SKETCH_ROWS * width / 2, 1);
+            if (!partition->sketch) {
+                return RC_MEMORY_ALLOCATION_FAIL;
+            }
+            partition->sketchMask = width - 1;
+        }
+    }
+    return RC_OK;
+}
+
+// Allocate zeroed page data for a chunk. Large arenas are mapped: reserved huge pages if
+// the system has them, else memory aligned to huge pages with MADV_HUGEPAGE, else plain
+// pages; the heap is the last resort
+static char *allocArena(size_t bytes, BM_ArenaBacking *backing, size_t *mappedBytes) {
+    *mappedBytes = 0;
+    if (bytes >= HUGE_PAGE_SIZE) {
+        size_t length = (bytes + HUGE_PAGE_SIZE - 1) & ~((size_t)HUGE_PAGE_SIZE - 1);
+#ifdef MAP_HUGETLB
+        char *arena = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (arena != MAP_FAILED) {
+            *backing = ARENA_HUGETLB;
+            *mappedBytes = length;
+            return arena;
+        }
+#endif
+        // Map one huge page more and trim the ends so the arena starts on a huge page
+        char *mapping = mmap(NULL, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping != MAP_FAILED) {
+            char *start = (char *)(((size_t)mapping + HUGE_PAGE_SIZE - 1) & ~((size_t)HUGE_PAGE_SIZE - 1));
+            if (start > mapping) {
+                munmap(mapping, start - mapping);
+            }
+            munmap(start + length, mapping + HUGE_PAGE_SIZE - start);
+            *backing = ARENA_PAGES;
+#ifdef MADV_HUGEPAGE
+            if (madvise(start, length, MADV_HUGEPAGE) == 0) {
+                *backing = ARENA_THP;
+            }
+#endif
+            *mappedBytes = length;
+            return start;
+        }
+    }
+    *backing = ARENA_HEAP;
+    return (char *)calloc(bytes, sizeof(char));
+}
+
+// Release page data allocated by allocArena
+static void freeArena(char *arena, size_t mappedBytes) {
+    if (mappedBytes > 0) {
+        munmap(arena, mappedBytes);
+    } else {
+        free(arena);
+    }
+}
+
+// Recompute the arena figures getPoolStats reports after a chunk was added or freed
+static void updateArenaStats(BufferPoolInfo *bufferInfo) {
+    BM_ArenaBacking backing = ARENA_HUGETLB;
+    long long bytes = 0;
+    for (int c = 0; c < bufferInfo->numChunks; c++) {
+        FrameChunk *chunk = &bufferInfo->chunks[c];
+        if (chunk->data != NULL) {
+            backing = chunk->backing < backing ? chunk->backing : backing;
+            bytes += chunk->mappedBytes > 0 ? (long long)chunk->mappedBytes : (long long)chunk->numSlots * PAGE_SIZE;
+        }
+    }
+    __atomic_store_n(&bufferInfo->arenaBacking, bytes > 0 ? backing : ARENA_HEAP, __ATOMIC_RELAXED);
+    __atomic_store_n(&bufferInfo->arenaBytes, bytes, __ATOMIC_RELAXED);
+}
+
+// Allocate page data and frame latches for numSlots more frames, returns the chunk's
+// index or NO_PAGE if memory ran out; the caller assigns the slots to frames
+static int addFrameChunk(BufferPoolInfo *bufferInfo, int numSlots) {
+    int c;
+
+    // Reuse the entry of a chunk released by an earlier shrink
+    for (c = 0; c < bufferInfo->numChunks && bufferInfo->chunks[c].data != NULL; c++)
+        ;
+    if (c == bufferInfo->numChunks) {
+        FrameChunk *chunks = (FrameChunk *)realloc(bufferInfo->chunks, (bufferInfo->numChunks + 1) * sizeof(FrameChunk));
+        if (!chunks) {
+            return NO_PAGE;
+        }
+        bufferInfo->chunks = chunks;
+        bufferInfo->numChunks++;
+    }
+
+    FrameChunk *chunk = &bufferInfo->chunks[c];
+    chunk->data = allocArena((size_t)numSlots * PAGE_SIZE, &chunk->backing, &chunk->mappedBytes);
+    chunk->latches = (pthread_rwlock_t *)calloc(numSlots, sizeof(pthread_rwlock_t));
+    if (!chunk->data || !chunk->latches) {
+        if (chunk->data) {
+            freeArena(chunk->data, chunk->mappedBytes);
+        }
+        free(chunk->latches);
+        memset(chunk, 0, sizeof(FrameChunk));
+        return NO_PAGE;
+    }
+    for (int i = 0; i < numSlots; i++) {
+        pthread_rwlock_init(&chunk->latches[i], NULL);
+    }
+    chunk->numSlots = numSlots;
+    chunk->liveSlots = numSlots;
+    updateArenaStats(bufferInfo);
+    return c;
+}
+
+// Free a chunk's page data and frame latches, the entry stays for reuse
+static void freeFrameChunk(FrameChunk *chunk) {
+    if (chunk->data == NULL) {
+        return;
+    }
+    for (int i = 0; i < chunk->numSlots; i++) {
+        pthread_rwlock_destroy(&chunk->latches[i]);
+    }
+    freeArena(chunk->data, chunk->mappedBytes);
+    free(chunk->latches);
+    memset(chunk, 0, sizeof(FrameChunk));
+}
+
+// Point a BM_BufferPool at a file of a pool
+static RC createHandle(BM_BufferPool *const bufferPool, BufferPoolInfo *bufferInfo, int fileId, const char *const pageFileName) {
+    PoolHandle *handle = (PoolHandle *)calloc(1, sizeof(PoolHandle));
+    if (!handle) {
+        return RC_MEMORY_ALLOCATION_FAIL;
+    }
+    handle->pool = bufferInfo;
+    handle->fileId = fileId;
+
+    // Initialize BM_BufferPool structure
+    bufferPool->pageFile = pageFileName ? strdup(pageFileName) : NULL;
+    bufferPool->numPages = bufferInfo->maxPages;
+    bufferPool->mgmtData = handle;
+    handle->bufferPool = bufferPool;
+
+    pthread_mutex_lock(&bufferInfo->ioLatch);
+    bufferPool->strategy = bufferInfo->strategyType;
+    handle->next = bufferInfo->handles;
+    bufferInfo->handles = handle;
+    pthread_mutex_unlock(&bufferInfo->ioLatch);
+    return RC_OK;
+}
+
+// Register a page file with the pool, sharing the slot if the file is attached already
+static RC attachFile(BufferPoolInfo *bufferInfo, const char *const pageFileName, int *fileIdOut) {
+    int fileId = NO_PAGE;
+    RC status = RC_OK;
+
+    pthread_mutex_lock(&bufferInfo->ioLatch);
+    for (int i = 0; i < bufferInfo->numFiles; i++) {
+        if (bufferInfo->files[i].refCount > 0 && strcmp(bufferInfo->files[i].fileName, pageFileName) == 0) {
+            bufferInfo->files[i].refCount++;
+            *fileIdOut = i;
+            pthread_mutex_unlock(&bufferInfo->ioLatch);
+            return RC_OK;
+        }
+        if (bufferInfo->files[i].refCount == 0 && fileId == NO_PAGE) {
+            fileId = i;
+        }
+    }
+
+    // No free slot: grow the file table
+    if (fileId == NO_PAGE) {
+        PoolFile *files = (PoolFile *)realloc(bufferInfo->files, (bufferInfo->numFiles + 1) * sizeof(PoolFile));
+        if (!files) {
+            pthread_mutex_unlock(&bufferInfo->ioLatch);
+            return RC_MEMORY_ALLOCATION_FAIL;
+        }
+        bufferInfo->files = files;
+        fileId = bufferInfo->numFiles++;
+        memset(&bufferInfo->files[fileId], 0, sizeof(PoolFile));
+    }
+
+    // Open the page file
+    PoolFile *file = &bufferInfo->files[fileId];
+    file->fileName = strdup(pageFileName);
+    if (!file->fileName) {
+        status = RC_MEMORY_ALLOCATION_FAIL;
+    } else {
+        status = openPageFile(file->fileName, &file->fileHandle);
+    }
+    if (status != RC_OK) {
+        free(file->fileName);
+        file->fileName = NULL;
+    } else {
+        file->refCount = 1;
+        *fileIdOut = fileId;
+    }
+    pthread_mutex_unlock(&bufferInfo->ioLatch);
+
+    return status;
+}
+
+// Drop a handle's reference to a page file; the last one writes the file's dirty
+// pages, frees its frames and closes it. Fails if a page of the file is pinned
+static RC detachFile(BufferPoolInfo *bufferInfo, int fileId) {
+    RC status = RC_OK;
+    int p, i;
+
+    pthread_mutex_lock(&bufferInfo->ioLatch);
+    if (bufferInfo->files[fileId].refCount > 1) {
+        bufferInfo->files[fileId].refCount--;
+        pthread_mutex_unlock(&bufferInfo->ioLatch);
+        return RC_OK;
+    }
+    pthread_mutex_unlock(&bufferInfo->ioLatch);
+
+    // The prefetcher must not load pages of the file or hold a pin during the check,
+    // nor may a write-back in flight
+    stopPrefetcher(bufferInfo);
+    closeIoGate(bufferInfo);
+
+    for (p = 0; p < bufferInfo->numPartitions; p++) {
+        pthread_mutex_lock(&bufferInfo->partitions[p].tableLatch);
+    }
+    for (i = 0; i < bufferInfo->maxPages && status == RC_OK; i++) {
+        if (bufferInfo->frames[i].fileId == fileId && fixCountOf(bufferInfo, i) != 0) {
+            status = RC_BUFFERPOOL_IN_USE;
+        }
+    }
+
+    if (status == RC_OK) {
+        saveWarmPages(bufferInfo, fileId);
+        pthread_mutex_lock(&bufferInfo->ioLatch);
+        status = writeDirtyPagesToDisk(bufferInfo, fileId, FALSE);
+        if (status == RC_OK) {
+            if (closePageFile(&bufferInfo->files[fileId].fileHandle) != RC_OK) {
+                status = RC_CLOSE_FAILED;
+            }
+            free(bufferInfo->files[fileId].fileName);
+            bufferInfo->files[fileId].fileName = NULL;
+            bufferInfo->files[fileId].refCount = 0;
+        }
+        pthread_mutex_unlock(&bufferInfo->ioLatch);
+
+        for (p = 0; p < bufferInfo->numPartitions; p++) {
+            PoolPartition *partition = &bufferInfo->partitions[p];
+            for (i = partition->firstFrame; i < partition->firstFrame + partition->numFrames; i++) {
+                if (bufferInfo->frames[i].fileId == fileId) {
+                    releaseFrame(bufferInfo, partition, i);
+                }
+            }
+        }
+        // The file's slot may be reused for another file
+        tierDropFile(bufferInfo->tier, fileId);
+    }
+
+    for (p = bufferInfo->numPartitions - 1; p >= 0; p--) {
+        pthread_mutex_unlock(&bufferInfo->partitions[p].tableLatch);
+    }
+    openIoGate(bufferInfo);
+    return status;
+}
+
+// Shut down the buffer pool; on a shared pool only the handle's file is detached
+RC shutdownBufferPool(BM_BufferPool *const bufferPool)
+{
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
+        return RC_ERROR;
+    }
+
+    PoolHandle *handle = bufferPool->mgmtData;
+    BufferPoolInfo *bufferInfo = handle->pool;
+    RC status;
+
+    if (bufferInfo->shared) {
+        status = detachFile(bufferInfo, handle->fileId);
+        if (status != RC_OK) {
+            return status;
+        }
+        pthread_mutex_lock(&bufferInfo->ioLatch);
+        for (PoolHandle **link = &bufferInfo->handles; *link != NULL; link = &(*link)->next) {
+            if (*link == handle) {
+                *link = handle->next;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&bufferInfo->ioLatch);
+    } else {
+        // Pending prefetches are dropped, the prefetcher must not hold a pin during the
+        // check, nor may a write-back in flight. The writer is stopped before the final
+        // flush and before the partitions are latched, as it takes their latches
+        bool writerRunning = bufferInfo->writerStarted;
+        int p;
+        stopPrefetcher(bufferInfo);
+        closeIoGate(bufferInfo);
+        stopBackgroundWriter(bufferInfo);
+
+        for (p = 0; p < bufferInfo->numPartitions; p++) {
+            pthread_mutex_lock(&bufferInfo->partitions[p].tableLatch);
+        }
+        status = RC_OK;
+        for (int i = 0; i < bufferInfo->maxPages && status == RC_OK; i++) {
+            if (fixCountOf(bufferInfo, i) != 0) {
+                status = RC_BUFFERPOOL_IN_USE;
+            }
+        }
+
+        if (status == RC_OK) {
+            saveWarmPages(bufferInfo, handle->fileId);
+
+            // Write dirty pages to disk and close the file
+            pthread_mutex_lock(&bufferInfo->ioLatch);
+            status = writeDirtyPagesToDisk(bufferInfo, handle->fileId, FALSE);
+            if (status == RC_OK && closePageFile(&bufferInfo->files[handle->fileId].fileHandle) != RC_OK) {
+                status = RC_CLOSE_FAILED;
+            }
+            pthread_mutex_unlock(&bufferInfo->ioLatch);
+        }
+
+        for (p = bufferInfo->numPartitions - 1; p >= 0; p--) {
+            pthread_mutex_unlock(&bufferInfo->partitions[p].tableLatch);
+        }
+        if (status != RC_OK) {
+            // The pool stays usable: reopen the gate and restart the writer
+            openIoGate(bufferInfo);
+            if (writerRunning) {
+                startBackgroundWriter(bufferInfo, &bufferInfo->writerOptions);
+            }
+            return status;
+        }
+        free(bufferInfo->files[handle->fileId].fileName);
+        bufferInfo->files[handle->fileId].fileName = NULL;
+
+        releaseBufferMemory(bufferInfo);
+    }
+
+    free(handle->frameContentsView);
+    free(handle->dirtyFlagsView);
+    free(handle->fixCountsView);
+    free(handle);
+    bufferPool->mgmtData = NULL;
+
+    return RC_OK;
+}
+
+
+
+// Helper function to write the dirty pages of a file to disk: the frames are sorted
+// by page number, the file is grown once and every run of consecutive pages goes out
+// in one vectored write. The caller holds the I/O latch and the latches of the
+// partitions involved; pinned pages are skipped if unpinnedOnly is set
+static RC writeDirtyPagesToDisk(BufferPoolInfo *bufferInfo, int fileId, bool unpinnedOnly) {
+    FlushCandidate *candidates = (FlushCandidate *)malloc(bufferInfo->maxPages * sizeof(FlushCandidate));
+    int numCandidates = 0;
+
+    if (!candidates) {
+        return RC_MEMORY_ALLOCATION_FAIL;
+    }
+    for (int i = 0; i < bufferInfo->maxPages; i++) {
+        if (bufferInfo->frames[i].isDirty && bufferInfo->frames[i].fileId == fileId &&
+            (!unpinnedOnly || fixCountOf(bufferInfo, i) == 0)) {
+            candidates[numCandidates].fileId = fileId;
+            candidates[numCandidates].pageNum = bufferInfo->frames[i].pageNumber;
+            candidates[numCandidates].frame = i;
+            numCandidates++;
+        }
+    }
+    qsort(candidates, numCandidates, sizeof(FlushCandidate), compareFlushCandidates);
+
+    RC status = writeSortedRuns(bufferInfo, candidates, numCandidates);
+    if (status == RC_OK) {
+        for (int c = 0; c < numCandidates; c++) {
+            PoolPartition *partition = partitionOf(bufferInfo, fileId, candidates[c].pageNum);
+            clearDirty(bufferInfo, candidates[c].frame);
+            countEvent(&partition->writeCount);
+            countEvent(&partition->flushCount);
+        }
+    }
+
+    free(candidates);
+    return status;
+}
+
+// Write frames sorted by file and page number: grow each file once to its highest page,
+// then write each run of consecutive pages with writeBlocks; the caller holds the I/O latch
+static RC writeSortedRuns(BufferPoolInfo *bufferInfo, const FlushCandidate *candidates, int numCandidates) {
+    SM_PageHandle *runPages = (SM_PageHandle *)malloc((numCandidates > 0 ? numCandidates : 1) * sizeof(SM_PageHandle));
+    RC status = RC_OK;
+
+    if (!runPages) {
+        return RC_MEMORY_ALLOCATION_FAIL;
+    }
+    for (int first = 0; first < numCandidates && status == RC_OK; ) {
+        SM_FileHandle *fileHandle = &bufferInfo->files[candidates[first].fileId].fileHandle;
+        int last = first;
+
+        while (last + 1 < numCandidates && candidates[last + 1].fileId == candidates[first].fileId) {
+            last++;
+        }
+        status = ensureCapacity(candidates[last].pageNum + 1, fileHandle);
+
+        for (int run = first; run <= last && status == RC_OK; ) {
+            int length = 0;
+            while (run + length <= last && candidates[run + length].pageNum == candidates[run].pageNum + length) {
+                runPages[length] = bufferInfo->frames[candidates[run + length].frame].data;
+                length++;
+            }
+            if (writeBlocks(candidates[run].pageNum, length, fileHandle, runPages) != RC_OK) {
+                status = RC_WRITE_FAILED;
+            }
+            run += length;
+        }
+        first = last + 1;
+    }
+
+    free(runPages);
+    return status;
+}
+
+
+
+// Helper function to free all allocated buffer memory
+static void releaseBufferMemory(BufferPoolInfo *bufferInfo) {
+    closeTrace(bufferInfo);
+
+    // Free and reset memory allocations
+    if (bufferInfo->frames) {
+        free(bufferInfo->frames);
+        bufferInfo->frames = NULL;
+    }
+    for (int c = 0; c < bufferInfo->numChunks; c++) {
+        freeFrameChunk(&bufferInfo->chunks[c]);
+    }
+    free(bufferInfo->chunks);
+    if (bufferInfo->partitions) {
+        for (int p = 0; p < bufferInfo->numPartitions; p++) {
+            free(bufferInfo->partitions[p].hashBuckets);
+            free(bufferInfo->partitions[p].sketch);
+            pthread_mutex_destroy(&bufferInfo->partitions[p].tableLatch);
+            pthread_cond_destroy(&bufferInfo->partitions[p].frameFreed);
+        }
+        free(bufferInfo->partitions);
+        bufferInfo->partitions = NULL;
+    }
+    free(bufferInfo->files);
+    free(bufferInfo->flushCandidates);
+    free(bufferInfo->flushPage);
+    free(bufferInfo->prefetchQueue);
+    freeTier(bufferInfo->tier);
+    freeAdaptive(bufferInfo->adaptive);
+    pthread_mutex_destroy(&bufferInfo->ioLatch);
+    pthread_cond_destroy(&bufferInfo->unlatchedIoDone);
+    pthread_mutex_destroy(&bufferInfo->writerLatch);
+    pthread_cond_destroy(&bufferInfo->writerWake);
+    pthread_mutex_destroy(&bufferInfo->prefetchLatch);
+    pthread_cond_destroy(&bufferInfo->prefetchWake);
+    pthread_mutex_destroy(&bufferInfo->resizeLatch);
+    pthread_mutex_destroy(&bufferInfo->traceLatch);
+
+    // Free the BufferPoolInfo structure itself
+    free(bufferInfo);
+}
+
+// Function to force flushing the buffer pool to disk
+RC forceFlushPool(BM_BufferPool *const bufferPool) {
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
+        return RC_ERROR;
+    }
+
+    PoolHandle *handle = bufferPool->mgmtData;
+    BufferPoolInfo *bufferInfo = handle->pool;
+    RC status;
+    int p;
+
+    // Flush the file's dirty pages that are not currently pinned, in page order across all partitions
+    for (p = 0; p < bufferInfo->numPartitions; p++) {
+        pthread_mutex_lock(&bufferInfo->partitions[p].tableLatch);
+    }
+    pthread_mutex_lock(&bufferInfo->ioLatch);
+    status = writeDirtyPagesToDisk(bufferInfo, handle->fileId, TRUE);
+    pthread_mutex_unlock(&bufferInfo->ioLatch);
+    for (p = bufferInfo->numPartitions - 1; p >= 0; p--) {
+        pthread_mutex_unlock(&bufferInfo->partitions[p].tableLatch);
+    }
+
+    return status;
+}
+
+
+/*******************************************
+*  Buffer Manager Interface Pool Resizing
+*******************************************/
+
+// A frame's page data and latch while frames are renumbered
+typedef struct FrameSlot
+{
+    int chunk;
+    char *data;
+    pthread_rwlock_t *latch;
+} FrameSlot;
+
+static int compareFrameSlots(const void *a, const void *b) {
+    const FrameSlot *left = a;
+    const FrameSlot *right = b;
+    if (left->chunk != right->chunk) {
+        return (left->chunk > right->chunk) - (left->chunk < right->chunk);
+    }
+    return (left->data > right->data) - (left->data < right->data);
+}
+
+// Grow or shrink the pool to newNumPages frames while it stays in use. Growing adds
+// a chunk of frames, shrinking evicts unpinned pages in replacement order; buffered
+// pages keep their data, so pinned page handles stay valid. Arrays returned by the
+// statistics functions before the resize must not be used afterwards
+RC resizeBufferPool(BM_BufferPool *const bm, const int newNumPages) {
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    BufferPoolInfo *bufferInfo = ((PoolHandle *)bm->mgmtData)->pool;
+
+    // Every partition keeps at least one frame
+    if (newNumPages < bufferInfo->numPartitions) {
+        return RC_ERROR;
+    }
+
+    pthread_mutex_lock(&bufferInfo->resizeLatch);
+    RC status = RC_OK;
+    if (newNumPages != bufferInfo->maxPages) {
+        // The writer's candidate list is sized to the pool, restart it with new watermarks
+        bool writerRunning = bufferInfo->writerStarted;
+        stopBackgroundWriter(bufferInfo);
+
+        status = rebuildFrames(bufferInfo, newNumPages);
+
+        if (writerRunning && startBackgroundWriter(bufferInfo, &bufferInfo->writerOptions) != RC_OK && status == RC_OK) {
+            status = RC_MEMORY_ALLOCATION_FAIL;
+        }
+    }
+    bm->numPages = bufferInfo->maxPages;
+    pthread_mutex_unlock(&bufferInfo->resizeLatch);
+
+    return status;
+}
+
+// Renumber the frames for a pool of newNumPages frames with all partitions latched:
+// each partition keeps its buffered pages in replacement order at the start of its
+// new frame range, followed by its free frames
+static RC rebuildFrames(BufferPoolInfo *bufferInfo, int newNumPages) {
+    int oldNumPages = bufferInfo->maxPages;
+    int numPartitions = bufferInfo->numPartitions;
+    RC status = RC_OK;
+    int p, f, i;
+
+    // Frames being read or written without their partition latch must not move
+    closeIoGate(bufferInfo);
+    for (p = 0; p < numPartitions; p++) {
+        pthread_mutex_lock(&bufferInfo->partitions[p].tableLatch);
+    }
+
+    // A shrink must find enough unpinned pages to evict in every partition; the dirty
+    // ones are written back first, so the renumbering below cannot fail halfway
+    for (p = 0; p < numPartitions && status == RC_OK; p++) {
+        PoolPartition *partition = &bufferInfo->partitions[p];
+        int newFrames = newNumPages / numPartitions + (p < newNumPages % numPartitions ? 1 : 0);
+        int excess = partition->numFrames - partition->availableSlots - newFrames;
+
+        for (f = partition->orderHead; f != NO_PAGE && excess > 0 && status == RC_OK; f = bufferInfo->frames[f].orderNext) {
+            if (fixCountOf(bufferInfo, f) == 0) {
+                status = writeBackFrame(bufferInfo, partition, f);
+                excess--;
+            }
+        }
+        if (excess > 0 && status == RC_OK) {
+            status = RC_BUFFERPOOL_IN_USE;
+        }
+    }
+
+    BM_PageFrame *frames = allocFrames(newNumPages);
+    PrefetchRequest *prefetchQueue = (PrefetchRequest *)malloc(newNumPages * sizeof(PrefetchRequest));
+    int **hashBuckets = (int **)calloc(numPartitions, sizeof(int *));
+    int *hashMasks = (int *)malloc(numPartitions * sizeof(int));
+    FrameSlot *spareSlots = (FrameSlot *)malloc((oldNumPages > newNumPages ? oldNumPages : newNumPages) * sizeof(FrameSlot));
+    bool *carried = (bool *)calloc(oldNumPages, sizeof(bool));
+    int numSpareSlots = 0;
+    int newChunk = NO_PAGE;
+
+    if (status == RC_OK && (!frames || !prefetchQueue || !hashBuckets || !hashMasks || !spareSlots || !carried)) {
+        status = RC_MEMORY_ALLOCATION_FAIL;
+    }
+    for (p = 0; p < numPartitions && status == RC_OK; p++) {
+        int newFrames = newNumPages / numPartitions + (p < newNumPages % numPartitions ? 1 : 0);
+        int bucketCount = 2;
+        while (bucketCount < 2 * newFrames) {
+            bucketCount <<= 1;
+        }
+        hashBuckets[p] = (int *)malloc(bucketCount * sizeof(int));
+        if (!hashBuckets[p]) {
+            status = RC_MEMORY_ALLOCATION_FAIL;
+            break;
+        }
+        hashMasks[p] = bucketCount - 1;
+        for (i = 0; i < bucketCount; i++) {
+            hashBuckets[p][i] = NO_PAGE;
+        }
+    }
+    if (status == RC_OK && newNumPages > oldNumPages) {
+        newChunk = addFrameChunk(bufferInfo, newNumPages - oldNumPages);
+        if (newChunk == NO_PAGE) {
+            status = RC_MEMORY_ALLOCATION_FAIL;
+        }
+    }
+
+    if (status == RC_OK) {
+        int newFrame = 0;
+        int slot = 0;
+
+        // Optimistic readers holding frame numbers of the old layout must start over
+        __atomic_add_fetch(&bufferInfo->layoutVersion, 1, __ATOMIC_ACQ_REL);
+
+        // The slots of the frames added by a grow are spare to begin with
+        for (i = 0; newChunk != NO_PAGE && i < bufferInfo->chunks[newChunk].numSlots; i++) {
+            spareSlots[numSpareSlots].chunk = newChunk;
+            spareSlots[numSpareSlots].data = bufferInfo->chunks[newChunk].data + (size_t)i * PAGE_SIZE;
+            spareSlots[numSpareSlots].latch = &bufferInfo->chunks[newChunk].latches[i];
+            numSpareSlots++;
+        }
+
+        for (p = 0; p < numPartitions; p++) {
+            PoolPartition *partition = &bufferInfo->partitions[p];
+            int newFrames = newNumPages / numPartitions + (p < newNumPages % numPartitions ? 1 : 0);
+            int excess = partition->numFrames - partition->availableSlots - newFrames;
+            int first = newFrame;
+
+            // Shrink: evict unpinned pages from the head of the replacement order, they
+            // were written back above
+            for (f = partition->orderHead; f != NO_PAGE && excess > 0; ) {
+                int next = bufferInfo->frames[f].orderNext;
+                if (fixCountOf(bufferInfo, f) == 0) {
+                    dropVictim(bufferInfo, partition, f, FALSE);
+                    excess--;
+                }
+                f = next;
+            }
+
+            // Carry the buffered pages over in replacement order
+            for (f = partition->orderHead; f != NO_PAGE; f = bufferInfo->frames[f].orderNext) {
+                int bucket = (int)(pageKeyHash(bufferInfo->frames[f].fileId, bufferInfo->frames[f].pageNumber) & (unsigned int)hashMasks[p]);
+
+                frames[newFrame] = bufferInfo->frames[f];
+                frames[newFrame].fixCount = fixCountOf(bufferInfo, f);
+                frames[newFrame].orderPrev = newFrame > first ? newFrame - 1 : NO_PAGE;
+                frames[newFrame].orderNext = NO_PAGE;
+                if (newFrame > first) {
+                    frames[newFrame - 1].orderNext = newFrame;
+                }
+                frames[newFrame].hashNext = hashBuckets[p][bucket];
+                hashBuckets[p][bucket] = newFrame;
+                carried[f] = TRUE;
+                if (bufferInfo->policy.onEvict) {
+                    bufferInfo->policy.onEvict(bufferInfo->policy.state, f);
+                }
+                newFrame++;
+            }
+
+            // Free and evicted frames of the old layout donate their slots
+            for (f = partition->firstFrame; f < partition->firstFrame + partition->numFrames; f++) {
+                if (!carried[f]) {
+                    spareSlots[numSpareSlots].chunk = bufferInfo->frames[f].chunk;
+                    spareSlots[numSpareSlots].data = bufferInfo->frames[f].data;
+                    spareSlots[numSpareSlots].latch = bufferInfo->frames[f].latch;
+                    numSpareSlots++;
+                }
+            }
+
+            partition->orderHead = newFrame > first ? first : NO_PAGE;
+            partition->orderTail = newFrame > first ? newFrame - 1 : NO_PAGE;
+            partition->firstFrame = first;
+            partition->numFrames = newFrames;
+            partition->availableSlots = newFrames - (newFrame - first);
+            partition->probationFrame = NO_PAGE;
+            newFrame = first + newFrames;
+        }
+
+        // Free frames take the spare slots of the oldest chunks, so the newest ones empty out first
+        qsort(spareSlots, numSpareSlots, sizeof(FrameSlot), compareFrameSlots);
+        for (p = 0; p < numPartitions; p++) {
+            PoolPartition *partition = &bufferInfo->partitions[p];
+            int end = partition->firstFrame + partition->numFrames;
+
+            partition->freeHead = partition->availableSlots > 0 ? end - partition->availableSlots : NO_PAGE;
+            for (f = end - partition->availableSlots; f < end; f++) {
+                frames[f].orderNext = f + 1 < end ? f + 1 : NO_PAGE;
+                frames[f].data = spareSlots[slot].data;
+                frames[f].latch = spareSlots[slot].latch;
+                frames[f].chunk = spareSlots[slot].chunk;
+                slot++;
+            }
+        }
+        // Chunks left without live slots are freed once no optimistic reader can use them
+        for (; slot < numSpareSlots; slot++) {
+            bufferInfo->chunks[spareSlots[slot].chunk].liveSlots--;
+        }
+
+        // Switch to the new layout; the old frames are freed with the chunks
+        BM_PageFrame *oldFrames = bufferInfo->frames;
+        __atomic_store_n(&bufferInfo->frames, frames, __ATOMIC_RELEASE);
+        for (p = 0; p < numPartitions; p++) {
+            free(bufferInfo->partitions[p].hashBuckets);
+            bufferInfo->partitions[p].hashBuckets = hashBuckets[p];
+            bufferInfo->partitions[p].hashMask = hashMasks[p];
+            hashBuckets[p] = NULL;
+        }
+
+        // Pending prefetches are dropped with the old queue
+        pthread_mutex_lock(&bufferInfo->prefetchLatch);
+        free(bufferInfo->prefetchQueue);
+        bufferInfo->prefetchQueue = prefetchQueue;
+        bufferInfo->prefetchHead = 0;
+        bufferInfo->prefetchCount = 0;
+        bufferInfo->maxPages = newNumPages;
+        pthread_mutex_unlock(&bufferInfo->prefetchLatch);
+        __atomic_add_fetch(&bufferInfo->layoutVersion, 1, __ATOMIC_RELEASE);
+
+        // The shadow caches start over at the sample size of the new pool
+        if (bufferInfo->adaptive != NULL) {
+            resetAdaptive(bufferInfo->adaptive, newNumPages);
+        }
+
+        // The policy sees the carried pages come back under their new numbers, in replacement order
+        if (bufferInfo->policy.onResize) {
+            bufferInfo->policy.onResize(bufferInfo->policy.state, newNumPages);
+        }
+        for (p = 0; p < numPartitions && bufferInfo->policy.onLoad; p++) {
+            for (f = bufferInfo->partitions[p].orderHead; f != NO_PAGE; f = bufferInfo->frames[f].orderNext) {
+                bufferInfo->policy.onLoad(bufferInfo->policy.state, f, FALSE);
+            }
+        }
+
+        frames = oldFrames;
+        prefetchQueue = NULL;
+    }
+
+    // Pins waiting for a frame look again, a grown pool has free frames now
+    for (p = numPartitions - 1; p >= 0; p--) {
+        if (bufferInfo->partitions[p].waitingPins > 0) {
+            pthread_cond_broadcast(&bufferInfo->partitions[p].frameFreed);
+        }
+        pthread_mutex_unlock(&bufferInfo->partitions[p].tableLatch);
+    }
+    openIoGate(bufferInfo);
+
+    if (status == RC_OK) {
+        waitForOptimisticReaders(bufferInfo);
+        for (i = 0; i < bufferInfo->numChunks; i++) {
+            if (bufferInfo->chunks[i].liveSlots == 0) {
+                freeFrameChunk(&bufferInfo->chunks[i]);
+            }
+        }
+        updateArenaStats(bufferInfo);
+    }
+
+    free(frames);
+    free(prefetchQueue);
+    for (p = 0; hashBuckets != NULL && p < numPartitions; p++) {
+        free(hashBuckets[p]);
+    }
+    free(hashBuckets);
+    free(hashMasks);
+    free(spareSlots);
+    free(carried);
+    return status;
+}
+
+
+/*******************************************
+*  Buffer Manager Interface Shared Pool
+*******************************************/
+
+// Create the process-wide pool, or join it if another module created it already;
+// the first caller's configuration (NULL for the defaults) sizes it
+RC initSharedBufferPool(const BM_SharedPoolConfig *config) {
+    RC status = RC_OK;
+
+    pthread_mutex_lock(&sharedPoolLatch);
+    if (sharedPool == NULL) {
+        int numPages = (config != NULL && config->numPages > 0) ? config->numPages : SHARED_POOL_DEFAULT_PAGES;
+        ReplacementStrategy strategy = (config != NULL) ? config->strategy : RS_LRU;
+
+        status = createPool(numPages, strategy, config != NULL ? config->policy : NULL,
+                            config != NULL ? &config->options : NULL, &sharedPool);
+        if (status == RC_OK) {
+            sharedPool->shared = TRUE;
+        } else {
+            sharedPool = NULL;
+        }
+    }
+    if (status == RC_OK) {
+        sharedPoolUsers++;
+    }
+    pthread_mutex_unlock(&sharedPoolLatch);
+
+    return status;
+}
+
+// Leave the process-wide pool; the last user frees it once every file is detached
+RC shutdownSharedBufferPool(void) {
+    RC status = RC_OK;
+
+    pthread_mutex_lock(&sharedPoolLatch);
+    if (sharedPool == NULL) {
+        pthread_mutex_unlock(&sharedPoolLatch);
+        return RC_SHUTDOWN_WITHOUT_INIT;
+    }
+
+    if (sharedPoolUsers == 1) {
+        for (int i = 0; i < sharedPool->numFiles; i++) {
+            if (sharedPool->files[i].refCount > 0) {
+                status = RC_BUFFERPOOL_IN_USE;
+            }
+        }
+        if (status == RC_OK) {
+            stopPrefetcher(sharedPool);
+            stopBackgroundWriter(sharedPool);
+            releaseBufferMemory(sharedPool);
+            sharedPool = NULL;
+        }
+    }
+    if (status == RC_OK) {
+        sharedPoolUsers--;
+    }
+    pthread_mutex_unlock(&sharedPoolLatch);
+
+    return status;
+}
+
+// Check whether the process-wide pool is up
+bool sharedBufferPoolActive(void) {
+    pthread_mutex_lock(&sharedPoolLatch);
+    bool active = sharedPool != NULL;
+    pthread_mutex_unlock(&sharedPoolLatch);
+    return active;
+}
+
+// Open a page file through the process-wide pool; the handle works like a private
+// pool and shutdownBufferPool detaches it again
+RC attachBufferPool(BM_BufferPool *const bm, const char *const pageFileName) {
+    if (bm == NULL || pageFileName == NULL) {
+        return RC_ERROR;
+    }
+
+    int fileId;
+
+    pthread_mutex_lock(&sharedPoolLatch);
+    if (sharedPool == NULL) {
+        pthread_mutex_unlock(&sharedPoolLatch);
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    RC status = attachFile(sharedPool, pageFileName, &fileId);
+    if (status == RC_OK) {
+        status = createHandle(bm, sharedPool, fileId, pageFileName);
+        if (status != RC_OK) {
+            detachFile(sharedPool, fileId);
+        } else if (sharedPool->files[fileId].refCount == 1) {
+            loadWarmPages(sharedPool, fileId);
+        }
+    }
+    pthread_mutex_unlock(&sharedPoolLatch);
+
+    return status;
+}
+
+
+// Function to update buffer statistics
+static void updateBufferStats(BufferPoolInfo *bufferInfo, PoolPartition *partition, int bufferIndex, int fileId, int pageNumber) {
+    // optimistic readers check these without the partition latch
+    __atomic_store_n(&bufferInfo->frames[bufferIndex].pageNumber, pageNumber, __ATOMIC_RELAXED);
+    __atomic_store_n(&bufferInfo->frames[bufferIndex].fileId, fileId, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&bufferInfo->frames[bufferIndex].fixCount, 1, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&bufferInfo->frames[bufferIndex].isDirty, FALSE, __ATOMIC_RELAXED);
+}
+
+// Seqlock writer side: make a frame's version odd before its content or page changes
+static inline void beginFrameWrite(unsigned int *version) {
+    __atomic_add_fetch(version, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+// Seqlock writer side: make the version even again once the frame is consistent
+static inline void endFrameWrite(unsigned int *version) {
+    __atomic_add_fetch(version, 1, __ATOMIC_RELEASE);
+}
+
+// Hash of a page key (multiplicative hashing); the file only mixes in for shared pools,
+// a private pool's single file has id 0
+static inline unsigned int pageKeyHash(int fileId, PageNumber pageNum) {
+    return (unsigned int)pageNum * 2654435761u + (unsigned int)fileId * 0x85ebca6bu;
+}
+
+// Partition responsible for a page; the high bits of the hash pick the partition,
+// the low bits the bucket inside it
+static PoolPartition *partitionOf(BufferPoolInfo *bufferInfo, int fileId, PageNumber pageNum) {
+    if (bufferInfo->numPartitions == 1) {
+        return bufferInfo->partitions;
+    }
+    unsigned int hash = pageKeyHash(fileId, pageNum);
+    return &bufferInfo->partitions[(hash >> 16) % (unsigned int)bufferInfo->numPartitions];
+}
+
+// Page table bucket of a page key
+static inline int pageBucket(PoolPartition *partition, int fileId, PageNumber pageNum) {
+    return (int)(pageKeyHash(fileId, pageNum) & (unsigned int)partition->hashMask);
+}
+
+// Find the frame holding a page, NO_PAGE if the page is not buffered
+static int lookupFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int fileId, PageNumber pageNum) {
+    int frame = partition->hashBuckets[pageBucket(partition, fileId, pageNum)];
+    while (frame != NO_PAGE && (bufferInfo->frames[frame].pageNumber != pageNum || bufferInfo->frames[frame].fileId != fileId)) {
+        frame = bufferInfo->frames[frame].hashNext;
+    }
+    return frame;
+}
+
+// Register a frame under its new page in the page table
+static void mapFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame) {
+    int bucket = pageBucket(partition, bufferInfo->frames[frame].fileId, bufferInfo->frames[frame].pageNumber);
+    bufferInfo->frames[frame].hashNext = partition->hashBuckets[bucket];
+    partition->hashBuckets[bucket] = frame;
+}
+
+// Remove a frame from the page table before its page is replaced
+static void unmapFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame) {
+    int *link = &partition->hashBuckets[pageBucket(partition, bufferInfo->frames[frame].fileId, bufferInfo->frames[frame].pageNumber)];
+    while (*link != NO_PAGE && *link != frame) {
+        link = &bufferInfo->frames[*link].hashNext;
+    }
+    if (*link == frame) {
+        *link = bufferInfo->frames[frame].hashNext;
+    }
+    bufferInfo->frames[frame].hashNext = NO_PAGE;
+}
+
+// Append a frame at the most recently used end of the replacement order
+static void appendToOrder(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame) {
+    bufferInfo->frames[frame].orderPrev = partition->orderTail;
+    bufferInfo->frames[frame].orderNext = NO_PAGE;
+    if (partition->orderTail != NO_PAGE) {
+        bufferInfo->frames[partition->orderTail].orderNext = frame;
+    } else {
+        partition->orderHead = frame;
+    }
+    partition->orderTail = frame;
+}
+
+// Insert a frame at the eviction end of the replacement order
+static void prependToOrder(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame) {
+    bufferInfo->frames[frame].orderPrev = NO_PAGE;
+    bufferInfo->frames[frame].orderNext = partition->orderHead;
+    if (partition->orderHead != NO_PAGE) {
+        bufferInfo->frames[partition->orderHead].orderPrev = frame;
+    } else {
+        partition->orderTail = frame;
+    }
+    partition->orderHead = frame;
+}
+
+// Insert a frame right behind another one of the replacement order, at its head if after is NO_PAGE
+static void insertIntoOrder(BufferPoolInfo *bufferInfo, PoolPartition *partition, int after, int frame) {
+    if (after == NO_PAGE) {
+        prependToOrder(bufferInfo, partition, frame);
+        return;
+    }
+    int next = bufferInfo->frames[after].orderNext;
+    bufferInfo->frames[frame].orderPrev = after;
+    bufferInfo->frames[frame].orderNext = next;
+    bufferInfo->frames[after].orderNext = frame;
+    if (next != NO_PAGE) {
+        bufferInfo->frames[next].orderPrev = frame;
+    } else {
+        partition->orderTail = frame;
+    }
+}
+
+// Take a frame out of the replacement order
+static void unlinkFromOrder(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame) {
+    int prev = bufferInfo->frames[frame].orderPrev;
+    int next = bufferInfo->frames[frame].orderNext;
+
+    if (prev != NO_PAGE) {
+        bufferInfo->frames[prev].orderNext = next;
+    } else {
+        partition->orderHead = next;
+    }
+    if (next != NO_PAGE) {
+        bufferInfo->frames[next].orderPrev = prev;
+    } else {
+        partition->orderTail = prev;
+    }
+    bufferInfo->frames[frame].orderPrev = NO_PAGE;
+    bufferInfo->frames[frame].orderNext = NO_PAGE;
+}
+
+// Eviction priority of a page class in a partition: its BM_PageClass, or that of data
+// pages once the class holds more than the pool's protectedPercent of the frames
+static inline int classPriority(BufferPoolInfo *bufferInfo, PoolPartition *partition, int pageClass) {
+    if (partition->classFrames[pageClass] * 100 > bufferInfo->protectedPercent * partition->numFrames) {
+        return BM_PAGE_DATA;
+    }
+    return pageClass;
+}
+
+// First unpinned frame of the lowest priority class from the head of the replacement
+// order, NO_PAGE if all are pinned. The walk stops at the first unpinned frame of the
+// lowest priority any buffered page has, so without page classes it takes the first one
+static int findVictimFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition) {
+    int victim = NO_PAGE;
+    int victimPriority = BM_NUM_PAGE_CLASSES;
+    int lowest = BM_NUM_PAGE_CLASSES;
+
+    for (int c = 0; c < BM_NUM_PAGE_CLASSES; c++) {
+        if (partition->classFrames[c] > 0 && classPriority(bufferInfo, partition, c) < lowest) {
+            lowest = classPriority(bufferInfo, partition, c);
+        }
+    }
+    for (int frame = partition->orderHead; frame != NO_PAGE; frame = bufferInfo->frames[frame].orderNext) {
+        if (fixCountOf(bufferInfo, frame) != 0) {
+            countEvent(&partition->pinnedSkips);
+            continue;
+        }
+        int priority = classPriority(bufferInfo, partition, bufferInfo->frames[frame].pageClass);
+        if (priority < victimPriority) {
+            victim = frame;
+            victimPriority = priority;
+            if (priority <= lowest) {
+                break;
+            }
+        }
+    }
+    return victim;
+}
+
+// Partition that owns a frame; partitions hold contiguous frame ranges, the first
+// maxPages % numPartitions of them one frame larger (see initPartitions)
+static PoolPartition *partitionOfFrame(BufferPoolInfo *bufferInfo, int frame) {
+    int smaller = bufferInfo->maxPages / bufferInfo->numPartitions;
+    int larger = bufferInfo->maxPages % bufferInfo->numPartitions;
+    int p = frame < larger * (smaller + 1) ? frame / (smaller + 1) : larger + (frame - larger * (smaller + 1)) / smaller;
+    return &bufferInfo->partitions[p];
+}
+
+// Built-in policies keep the partition's replacement order, which the pool maintains in
+// load order: FIFO replaces the first unpinned frame in it, LRU also moves hit pages to the back
+static int orderChooseVictim(void *state, int firstFrame, int numFrames, const BM_PageFrame *frames) {
+    BufferPoolInfo *bufferInfo = state;
+    return findVictimFrame(bufferInfo, partitionOfFrame(bufferInfo, firstFrame));
+}
+
+static void lruOnHit(void *state, int frame) {
+    BufferPoolInfo *bufferInfo = state;
+    PoolPartition *partition = partitionOfFrame(bufferInfo, frame);
+    unlinkFromOrder(bufferInfo, partition, frame);
+    appendToOrder(bufferInfo, partition, frame);
+    countEvent(&partition->lruPromotions);
+}
+
+// CLOCK runs its hand over the replacement order: a hit only sets the frame's reference
+// bit, and the hand moves referenced unpinned frames from the head to the back, clearing
+// the bit, until it reaches one that was not hit since it last passed
+static void clockOnHit(void *state, int frame) {
+    BufferPoolInfo *bufferInfo = state;
+    bufferInfo->frames[frame].referenced = TRUE;
+}
+
+static int clockChooseVictim(void *state, int firstFrame, int numFrames, const BM_PageFrame *frames) {
+    BufferPoolInfo *bufferInfo = state;
+    PoolPartition *partition = partitionOfFrame(bufferInfo, firstFrame);
+    int frame = partition->orderHead;
+
+    for (int passed = 0; frame != NO_PAGE && passed < numFrames; passed++) {
+        int next = bufferInfo->frames[frame].orderNext;
+        if (fixCountOf(bufferInfo, frame) == 0) {
+            if (!bufferInfo->frames[frame].referenced) {
+                break;
+            }
+            bufferInfo->frames[frame].referenced = FALSE;
+            unlinkFromOrder(bufferInfo, partition, frame);
+            appendToOrder(bufferInfo, partition, frame);
+        }
+        frame = next;
+    }
+    return findVictimFrame(bufferInfo, partition);
+}
+
+// LRU-K with K = 2: pages referenced once since they were loaded have no second-to-last
+// reference and go first, in load order; pages hit since follow in LRU order, which
+// stands in for the order of their second-to-last references
+static void lruKOnLoad(void *state, int frame, bool cold) {
+    BufferPoolInfo *bufferInfo = state;
+    PoolPartition *partition = partitionOfFrame(bufferInfo, frame);
+
+    bufferInfo->frames[frame].referenced = FALSE;
+    if (!cold) {
+        unlinkFromOrder(bufferInfo, partition, frame);
+        insertIntoOrder(bufferInfo, partition, partition->onceTail, frame);
+        partition->onceTail = frame;
+    } else if (partition->onceTail == NO_PAGE) {
+        partition->onceTail = frame;
+    }
+}
+
+static void lruKOnHit(void *state, int frame) {
+    BufferPoolInfo *bufferInfo = state;
+    PoolPartition *partition = partitionOfFrame(bufferInfo, frame);
+
+    if (!bufferInfo->frames[frame].referenced) {
+        if (frame == partition->onceTail) {
+            partition->onceTail = bufferInfo->frames[frame].orderPrev;
+        }
+        bufferInfo->frames[frame].referenced = TRUE;
+    }
+    unlinkFromOrder(bufferInfo, partition, frame);
+    appendToOrder(bufferInfo, partition, frame);
+    countEvent(&partition->lruPromotions);
+}
+
+static void lruKOnEvict(void *state, int frame) {
+    BufferPoolInfo *bufferInfo = state;
+    PoolPartition *partition = partitionOfFrame(bufferInfo, frame);
+    if (frame == partition->onceTail) {
+        partition->onceTail = bufferInfo->frames[frame].orderPrev;
+    }
+}
+
+// The renumbered pages are loaded again in replacement order, each referenced once
+static void lruKOnResize(void *state, int numFrames) {
+    BufferPoolInfo *bufferInfo = state;
+    for (int p = 0; p < bufferInfo->numPartitions; p++) {
+        bufferInfo->partitions[p].onceTail = NO_PAGE;
+    }
+}
+
+// Use the caller's policy, or the built-in one of the pool's strategy; LFU has none, its
+// pools only fill free frames
+static void setPolicy(BufferPoolInfo *bufferInfo, const BM_ReplacementPolicy *policy) {
+    memset(&bufferInfo->policy, 0, sizeof(BM_ReplacementPolicy));
+    if (policy != NULL) {
+        bufferInfo->policy = *policy;
+        return;
+    }
+    bufferInfo->policy.state = bufferInfo;
+    switch (bufferInfo->strategyType) {
+    case RS_FIFO:
+        bufferInfo->policy.chooseVictim = orderChooseVictim;
+        break;
+    case RS_LRU:
+        bufferInfo->policy.chooseVictim = orderChooseVictim;
+        bufferInfo->policy.onHit = lruOnHit;
+        break;
+    case RS_CLOCK:
+        bufferInfo->policy.chooseVictim = clockChooseVictim;
+        bufferInfo->policy.onHit = clockOnHit;
+        break;
+    case RS_LRU_K:
+        bufferInfo->policy.chooseVictim = orderChooseVictim;
+        bufferInfo->policy.onLoad = lruKOnLoad;
+        bufferInfo->policy.onHit = lruKOnHit;
+        bufferInfo->policy.onEvict = lruKOnEvict;
+        bufferInfo->policy.onResize = lruKOnResize;
+        break;
+    default:
+        break;
+    }
+}
+
+// Empty a clean, unpinned frame and put it back on its partition's free list
+static void releaseFrame(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame) {
+    countClassFrame(partition, bufferInfo->frames[frame].pageClass, -1);
+    if (frame == partition->probationFrame) {
+        partition->probationFrame = NO_PAGE;
+    }
+    if (bufferInfo->policy.onEvict) {
+        bufferInfo->policy.onEvict(bufferInfo->policy.state, frame);
+    }
+    beginFrameWrite(&bufferInfo->frames[frame].version);
+    unmapFrame(bufferInfo, partition, frame);
+    unlinkFromOrder(bufferInfo, partition, frame);
+    clearDirty(bufferInfo, frame);
+    __atomic_store_n(&bufferInfo->frames[frame].pageNumber, NO_PAGE, __ATOMIC_RELAXED);
+    __atomic_store_n(&bufferInfo->frames[frame].fileId, NO_PAGE, __ATOMIC_RELAXED);
+    endFrameWrite(&bufferInfo->frames[frame].version);
+
+    bufferInfo->frames[frame].orderNext = partition->freeHead;
+    partition->freeHead = frame;
+    partition->availableSlots++;
+}
+
+
+
+/*****************************************
+*  Buffer Manager Interface Access Pages
+*****************************************/
+
+// Mark a page as dirty in the buffer pool
+RC markDirty(BM_BufferPool *const bufferPool, BM_PageHandle *const page) {
+    // Check if buffer manager or management data is null
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    PoolHandle *handle = bufferPool->mgmtData;
+    BufferPoolInfo *bufferInfo = handle->pool;
+    PoolPartition *partition = partitionOf(bufferInfo, handle->fileId, page->pageNum);
+
+    // Look up the frame holding the page and flag it as modified
+    pthread_mutex_lock(&partition->tableLatch);
+    int frame = lookupFrame(bufferInfo, partition, handle->fileId, page->pageNum);
+    if (frame != NO_PAGE) {
+        setDirty(bufferInfo, frame);
+        // The content changed: optimistic reads that overlapped the change retry
+        __atomic_add_fetch(&bufferInfo->frames[frame].version, 2, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&partition->tableLatch);
+
+    return RC_OK;
+}
+
+// Tag a pinned page with its class; evictions pass over pages of higher classes while
+// pages of lower ones can go. A page above BM_PAGE_DATA stops being the probation frame,
+// so the admission filter's rejected misses do not replace it
+RC setPageClass(BM_BufferPool *const bufferPool, BM_PageHandle *const page, BM_PageClass pageClass) {
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (page == NULL || pageClass < BM_PAGE_DATA || pageClass >= BM_NUM_PAGE_CLASSES) {
+        return RC_ERROR;
+    }
+
+    PoolHandle *handle = bufferPool->mgmtData;
+    BufferPoolInfo *bufferInfo = handle->pool;
+    PoolPartition *partition = partitionOf(bufferInfo, handle->fileId, page->pageNum);
+
+    pthread_mutex_lock(&partition->tableLatch);
+    int frame = lookupFrame(bufferInfo, partition, handle->fileId, page->pageNum);
+    if (frame != NO_PAGE) {
+        countClassFrame(partition, bufferInfo->frames[frame].pageClass, -1);
+        countClassFrame(partition, pageClass, 1);
+        bufferInfo->frames[frame].pageClass = pageClass;
+        if (pageClass != BM_PAGE_DATA && frame == partition->probationFrame) {
+            partition->probationFrame = NO_PAGE;
+        }
+    }
+    pthread_mutex_unlock(&partition->tableLatch);
+
+    return RC_OK;
+}
+
+// Force a page to be written to disk from the buffer pool
+RC forcePage(BM_BufferPool *const bufferPool, BM_PageHandle *const page) {
+    // Check if buffer manager or management data is null
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    PoolHandle *handle = bufferPool->mgmtData;
+    BufferPoolInfo *bufferInfo = handle->pool;
+    PoolPartition *partition = partitionOf(bufferInfo, handle->fileId, page->pageNum);
+
+    // Look up the frame holding the page
+    pthread_mutex_lock(&partition->tableLatch);
+    int frame = lookupFrame(bufferInfo, partition, handle->fileId, page->pageNum);
+    if (frame == NO_PAGE) {
+        pthread_mutex_unlock(&partition->tableLatch);
+        return RC_WRITE_FAILED;
+    }
+
+    struct timespec start, end;
+    char pageCopy[PAGE_SIZE];
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Write a copy of the page so the partition is only latched for the copy; the I/O latch
+    // is taken first, so a later eviction of the page cannot overtake this write, and the
+    // frame stays fixed until the outcome is recorded
+    memcpy(pageCopy, bufferInfo->frames[frame].data, PAGE_SIZE);
+    __atomic_add_fetch(&bufferInfo->frames[frame].fixCount, 1, __ATOMIC_ACQ_REL);
+    clearDirty(bufferInfo, frame);
+    pthread_mutex_lock(&bufferInfo->ioLatch);
+    pthread_mutex_unlock(&partition->tableLatch);
+
+    SM_FileHandle *fileHandle = &bufferInfo->files[handle->fileId].fileHandle;
+    RC status = ensureCapacity(page->pageNum + 1, fileHandle);
+    if (status == RC_OK) {
+        status = writeBlock(page->pageNum, fileHandle, pageCopy);
+    }
+    if (status == RC_OK && bufferInfo->syncOnForce) {
+        status = syncPageFile(fileHandle);
+    }
+    pthread_mutex_unlock(&bufferInfo->ioLatch);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long long nanos = (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
+    long long maxNanos = __atomic_load_n(&bufferInfo->forceNanosMax, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&bufferInfo->forceCount, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&bufferInfo->forceNanosTotal, nanos, __ATOMIC_RELAXED);
+    while (nanos > maxNanos &&
+           !__atomic_compare_exchange_n(&bufferInfo->forceNanosMax, &maxNanos, nanos, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+
+    // A page that did not make it to disk is dirty again
+    pthread_mutex_lock(&partition->tableLatch);
+    if (status == RC_OK) {
+        countEvent(&partition->writeCount);
+        countEvent(&partition->flushCount);
+    } else {
+        setDirty(bufferInfo, frame);
+    }
+    releasePin(bufferInfo, partition, frame);
+    pthread_mutex_unlock(&partition->tableLatch);
+    if (status != RC_OK) {
+        return RC_WRITE_FAILED;
+    }
+
+    return RC_OK;
+}
+
+
+// Unpin a page in the buffer pool
+RC unpinPage(BM_BufferPool *const bufferPool, BM_PageHandle *const page) {
+    // Check if buffer manager or management data is null
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    PoolHandle *handle = bufferPool->mgmtData;
+    BufferPoolInfo *bufferInfo = handle->pool;
+    PoolPartition *partition = partitionOf(bufferInfo, handle->fileId, page->pageNum);
+
+    // Look up the frame holding the page and decrease its fix count
+    pthread_mutex_lock(&partition->tableLatch);
+    int frame = lookupFrame(bufferInfo, partition, handle->fileId, page->pageNum);
+    if (frame != NO_PAGE && fixCountOf(bufferInfo, frame) > 0) {
+        releasePin(bufferInfo, partition, frame);
+        if (bufferInfo->policy.onUnpin) {
+            bufferInfo->policy.onUnpin(bufferInfo->policy.state, frame);
+        }
+    }
+    pthread_mutex_unlock(&partition->tableLatch);
+    tracePage(bufferInfo, handle->fileId, page->pageNum, TRACE_UNPIN);
+
+    // If the page wasn't found in the buffer, return OK (consistent behavior)
+    return RC_OK;
+}
+
+
+// Pin a page in the buffer pool
+RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum){
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    PoolHandle *handle = bm->mgmtData;
+    BufferPoolInfo *buffer_pool = handle->pool;
+    PoolPartition *partition = partitionOf(buffer_pool, handle->fileId, pageNum);
+    pthread_rwlock_t *loadLatch;
+    int memory_address;
+
+    tracePage(buffer_pool, handle->fileId, pageNum, TRACE_PIN);
+    pthread_mutex_lock(&partition->tableLatch);
+    RC status = pinFrame(buffer_pool, partition, handle->fileId, page, pageNum, &memory_address, &loadLatch);
+    pthread_mutex_unlock(&partition->tableLatch);
+    waitForLoad(loadLatch);
+    if (buffer_pool->adaptive != NULL) {
+        switchPendingStrategy(buffer_pool);
+    }
+
+    return status;
+}
+
+// Pin a page into a frame of its partition, the caller holds the partition's table
+// latch. The latch may be released while a dirty victim is written or the page is read;
+// if the pin found the page still being read by another thread, loadLatch is set and
+// the caller passes it to waitForLoad once it released the table latch
+static RC pinFrame(BufferPoolInfo *buffer_pool, PoolPartition *partition, int fileId, BM_PageHandle *const page, const PageNumber pageNum, int *frameOut, pthread_rwlock_t **loadLatch){
+    int memory_address;
+    bool cold = FALSE;
+
+    *loadLatch = NULL;
+    if (partition->sketch != NULL) {
+        sketchRecord(partition, fileId, pageNum);
+    }
+    if (buffer_pool->adaptive != NULL) {
+        adaptiveRecord(buffer_pool, fileId, pageNum);
+    }
+
+    // Page already buffered: fix it and, under LRU, make it the most recently used. A
+    // victim written back without the latch leaves the partition changed, so look again
+    do {
+        if (pinBufferedFrame(buffer_pool, partition, fileId, page, pageNum, frameOut, loadLatch)) {
+            return RC_OK;
+        }
+        memory_address = claimAdmittedFrame(buffer_pool, partition, fileId, pageNum, &cold);
+    } while (memory_address == VICTIM_WRITTEN);
+
+    if (memory_address == NO_PAGE && buffer_pool->pinTimeoutMillis > 0) {
+        // Another thread may load the page while we wait, then it is a hit after all
+        memory_address = waitForFrame(buffer_pool, partition, fileId, page, pageNum, frameOut, loadLatch);
+        if (memory_address == HIT_WHILE_WAITING) {
+            return RC_OK;
+        }
+    }
+    countEvent(&partition->missCount);
+    if (memory_address == NO_PAGE || memory_address == EVICTION_FAILED) {
+        countEvent(&partition->pinFailures);
+        return memory_address == NO_PAGE ? RC_BUFFERPOOL_FULL : RC_WRITE_FAILED;
+    }
+
+    // The loaded frame becomes the most recently loaded one, unless the admission filter
+    // rejected the page
+    loadFrame(buffer_pool, partition, memory_address, fileId, page, pageNum, cold);
+    if (partition->sketch != NULL) {
+        partition->probationFrame = memory_address;
+    }
+    *frameOut = memory_address;
+    return RC_OK;
+}
+
+// Wait until an unpin lets the partition hand out a frame or the pool's pin timeout
+// passes; returns the claimed frame, NO_PAGE on timeout, EVICTION_FAILED, or
+// HIT_WHILE_WAITING if another thread loaded the page meanwhile and it was pinned. The
+// caller holds the table latch; loadLatch as for pinFrame
+static int waitForFrame(BufferPoolInfo *buffer_pool, PoolPartition *partition, int fileId, BM_PageHandle *const page, const PageNumber pageNum, int *frameOut, pthread_rwlock_t **loadLatch) {
+    struct timespec start, end, deadline;
+    int memory_address = NO_PAGE;
+    bool timedOut = FALSE;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += buffer_pool->pinTimeoutMillis / 1000;
+    deadline.tv_nsec += (buffer_pool->pinTimeoutMillis % 1000) * 1000 * 1000;
+    if (deadline.tv_nsec >= 1000 * 1000 * 1000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000 * 1000 * 1000;
+    }
+
+    partition->waitingPins++;
+    while (memory_address == NO_PAGE && !timedOut) {
+        timedOut = pthread_cond_timedwait(&partition->frameFreed, &partition->tableLatch, &deadline) == ETIMEDOUT;
+        do {
+            if (pinBufferedFrame(buffer_pool, partition, fileId, page, pageNum, frameOut, loadLatch)) {
+                memory_address = HIT_WHILE_WAITING;
+            } else {
+                memory_address = claimFrame(buffer_pool, partition, TRUE);
+            }
+        } while (memory_address == VICTIM_WRITTEN);
+    }
+    partition->waitingPins--;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long long nanos = (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
+    countEvent(&partition->blockedPins);
+    __atomic_store_n(&partition->blockedNanos, __atomic_load_n(&partition->blockedNanos, __ATOMIC_RELAXED) + nanos, __ATOMIC_RELAXED);
+    if (memory_address == NO_PAGE) {
+        countEvent(&partition->pinTimeouts);
+    }
+    return memory_address;
+}
+
+// Drop one pin of a frame, waking the pins waiting on a full partition once it can be
+// replaced; the caller holds the partition's table latch
+static void releasePin(BufferPoolInfo *bufferInfo, PoolPartition *partition, int frame) {
+    if (__atomic_sub_fetch(&bufferInfo->frames[frame].fixCount, 1, __ATOMIC_ACQ_REL) == 0 && partition->waitingPins > 0) {
+        pthread_cond_broadcast(&partition->frameFreed);
+    }
+}
+
+// Fix a page that is already buffered, FALSE if it is not. If its read is still running,
+// loadLatch is set to the frame latch its loader holds
+static bool pinBufferedFrame(BufferPoolInfo *buffer_pool, PoolPartition *partition, int fileId, BM_PageHandle *const page, const PageNumber pageNum, int *frameOut, pthread_rwlock_t **loadLatch){
+    int memory_address = lookupFrame(buffer_pool, partition, fileId, pageNum);
+    if (memory_address == NO_PAGE) {
+        return FALSE;
+    }
+
+    __atomic_add_fetch(&buffer_pool->frames[memory_address].fixCount, 1, __ATOMIC_ACQ_REL);
+    if (__atomic_load_n(&buffer_pool->frames[memory_address].loading, __ATOMIC_ACQUIRE)) {
+        *loadLatch = buffer_pool->frames[memory_address].latch;
+    }
+    countEvent(&partition->hitCount);
+    if (memory_address == partition->probationFrame) {
+        partition->probationFrame = NO_PAGE;
+    }
+    if (buffer_pool->policy.onHit) {
+        buffer_pool->policy.onHit(buffer_pool->policy.state, memory_address);
+    }
+    page->pageNum = pageNum;
+    page->data = buffer_pool->frames[memory_address].data;
+    *frameOut = memory_address;
+    return TRUE;
+}
+
+// Wait until the read of a page pinned by pinBufferedFrame is done, without any latch;
+// the pin keeps the frame latch where it is
+static void waitForLoad(pthread_rwlock_t *loadLatch) {
+    if (loadLatch != NULL) {
+        pthread_rwlock_rdlock(loadLatch);
+        pthread_rwlock_unlock(loadLatch);
+    }
+}
+
+// Choose a frame for a new page: free frames are handed out in order until the partition
+// is full, after that the first unpinned frame in FIFO/LRU order is replaced, or a batch
+// of victims is evicted with evictionBatch; NO_PAGE if the partition is full,
+// EVICTION_FAILED if a dirty victim could not be written back, and VICTIM_WRITTEN if
+// evictFrame wrote it back without the table latch, which mayUnlatch allows
+static int claimFrame(BufferPoolInfo *buffer_pool, PoolPartition *partition, bool mayUnlatch){
+    int memory_address;
+
+    if (partition->availableSlots > 0) {
+        memory_address = partition->freeHead;
+        partition->freeHead = buffer_pool->frames[memory_address].orderNext;
+        buffer_pool->frames[memory_address].orderNext = NO_PAGE;
+        partition->availableSlots--;
+        return memory_address;
+    }
+    if (buffer_pool->evictionBatch > 1) {
+        return claimVictimBatch(buffer_pool, partition, mayUnlatch);
+    }
+
+    memory_address = chooseVictimFrame(buffer_pool, partition);
+    if (memory_address != NO_PAGE) {
+        memory_address = evictFrame(buffer_pool, partition, memory_address, mayUnlatch);
+    }
+    return memory_address;
+}
+
+// The policy picks the victim; a frame outside the partition or still pinned is refused
+static int chooseVictimFrame(BufferPoolInfo *buffer_pool, PoolPartition *partition){
+    if (buffer_pool->policy.chooseVictim == NULL) {
+        return NO_PAGE;
+    }
+    int memory_address = buffer_pool->policy.chooseVictim(buffer_pool->policy.state, partition->firstFrame,
+                                                          partition->numFrames, buffer_pool->frames);
+    if (memory_address < partition->firstFrame || memory_address >= partition->firstFrame + partition->numFrames ||
+        fixCountOf(buffer_pool, memory_address) != 0) {
+        return NO_PAGE;
+    }
+    return memory_address;
+}
+
+// claimFrame with evictionBatch: take up to that many victims from the policy, write
+// the dirty ones back as sorted runs under one hold of the I/O latch, and put all but
+// the first on the free list, so the next misses skip the victim search. The victims
+// are fixed while the batch is collected, so the policy does not offer them twice, and
+// only leave the page table once the write succeeded; if it fails they all stay
+// buffered and dirty and the claim returns EVICTION_FAILED. With mayUnlatch the write
+// runs without the table latch, as in evictFrame: victims pinned or dirtied again
+// meanwhile stay buffered, the others all go to the free list, and the claim returns
+// VICTIM_WRITTEN
+static int claimVictimBatch(BufferPoolInfo *buffer_pool, PoolPartition *partition, bool mayUnlatch){
+    FlushCandidate victims[BM_MAX_EVICTION_BATCH];
+    FlushCandidate dirty[BM_MAX_EVICTION_BATCH];
+    bool wasDirty[BM_MAX_EVICTION_BATCH];
+    bool evicted[BM_MAX_EVICTION_BATCH];
+    int numVictims = 0;
+    int numDirty = 0;
+    int numLatched = 0;
+    bool unlatched = FALSE;
+    int v, d;
+
+    while (numVictims < buffer_pool->evictionBatch) {
+        int memory_address = chooseVictimFrame(buffer_pool, partition);
+        if (memory_address == NO_PAGE) {
+            break;
+        }
+        BM_PageFrame *victim = &buffer_pool->frames[memory_address];
+
+        __atomic_store_n(&victim->fixCount, 1, __ATOMIC_RELAXED);
+        victims[numVictims].fileId = victim->fileId;
+        victims[numVictims].pageNum = victim->pageNumber;
+        victims[numVictims].frame = memory_address;
+        wasDirty[numVictims] = victim->isDirty;
+        if (victim->isDirty) {
+            dirty[numDirty++] = victims[numVictims];
+        }
+        numVictims++;
+    }
+    if (numVictims == 0) {
+        return NO_PAGE;
+    }
+
+    RC status = RC_OK;
+    if (numDirty > 0) {
+        qsort(dirty, numDirty, sizeof(FlushCandidate), compareFlushCandidates);
+
+        // Unlatched only if the I/O gate is open and every dirty victim's frame latch is
+        // free; they are marked clean first, so an update during the write dirties them again
+        while (mayUnlatch && numLatched < numDirty &&
+               pthread_rwlock_tryrdlock(buffer_pool->frames[dirty[numLatched].frame].latch) == 0) {
+            numLatched++;
+        }
+        if (numLatched == numDirty) {
+            unlatched = beginUnlatchedIo(buffer_pool);
+        } else {
+            pthread_mutex_lock(&buffer_pool->ioLatch);
+        }
+        if (unlatched) {
+            for (d = 0; d < numDirty; d++) {
+                clearDirty(buffer_pool, dirty[d].frame);
+            }
+            pthread_mutex_unlock(&partition->tableLatch);
+        } else {
+            while (numLatched > 0) {
+                pthread_rwlock_unlock(buffer_pool->frames[dirty[--numLatched].frame].latch);
+            }
+        }
+        status = writeSortedRuns(buffer_pool, dirty, numDirty);
+        pthread_mutex_unlock(&buffer_pool->ioLatch);
+        while (numLatched > 0) {
+            pthread_rwlock_unlock(buffer_pool->frames[dirty[--numLatched].frame].latch);
+        }
+        if (unlatched) {
+            pthread_mutex_lock(&partition->tableLatch);
+        }
+    }
+
+    for (v = 0; v < numVictims; v++) {
+        int memory_address = victims[v].frame;
+        if (unlatched) {
+            evicted[v] = fixCountOf(buffer_pool, memory_address) == 1 && !buffer_pool->frames[memory_address].isDirty;
+            releasePin(buffer_pool, partition, memory_address);
+        } else {
+            evicted[v] = TRUE;
+            __atomic_store_n(&buffer_pool->frames[memory_address].fixCount, 0, __ATOMIC_RELAXED);
+        }
+    }
+    if (status != RC_OK) {
+        for (d = 0; unlatched && d < numDirty; d++) {
+            setDirty(buffer_pool, dirty[d].frame);
+        }
+        if (unlatched) {
+            endUnlatchedIo(buffer_pool);
+        }
+        return EVICTION_FAILED;
+    }
+    for (d = 0; d < numDirty; d++) {
+        if (!unlatched) {
+            clearDirty(buffer_pool, dirty[d].frame);
+        }
+        countEvent(&partition->writeCount);
+    }
+    countEvent(&partition->victimBatches);
+
+    for (v = 0; v < numVictims; v++) {
+        int memory_address = victims[v].frame;
+        BM_PageFrame *victim = &buffer_pool->frames[memory_address];
+
+        if (!evicted[v]) {
+            continue;
+        }
+        if (wasDirty[v]) {
+            countEvent(&partition->dirtyEvictionCount);
+        }
+        countEvent(&partition->evictionCount);
+        countClassFrame(partition, victim->pageClass, -1);
+        if (memory_address == partition->probationFrame) {
+            partition->probationFrame = NO_PAGE;
+        }
+        if (buffer_pool->policy.onEvict) {
+            buffer_pool->policy.onEvict(buffer_pool->policy.state, memory_address);
+        }
+        tierStore(buffer_pool->tier, victims[v].fileId, victims[v].pageNum, victim->data);
+
+        beginFrameWrite(&victim->version);
+        unmapFrame(buffer_pool, partition, memory_address);
+        unlinkFromOrder(buffer_pool, partition, memory_address);
+        __atomic_store_n(&victim->pageNumber, NO_PAGE, __ATOMIC_RELAXED);
+        __atomic_store_n(&victim->fileId, NO_PAGE, __ATOMIC_RELAXED);
+        endFrameWrite(&victim->version);
+    }
+
+    // The first victim is the miss's frame, the others go to the free list in their order;
+    // after an unlatched write the first one does too, the miss takes it on its retry
+    for (v = numVictims - 1; v >= (unlatched ? 0 : 1); v--) {
+        if (evicted[v]) {
+            buffer_pool->frames[victims[v].frame].orderNext = partition->freeHead;
+            partition->freeHead = victims[v].frame;
+            partition->availableSlots++;
+        }
+    }
+    if (unlatched) {
+        endUnlatchedIo(buffer_pool);
+        return VICTIM_WRITTEN;
+    }
+    return victims[0].frame;
+}
+
+// claimFrame for a missed page behind the admission filter: the page only displaces the
+// policy's victim if the sketch estimates it was pinned more often. A rejected page
+// replaces the probation frame instead (the victim if there is none, or if it holds a
+// page of a higher class) and is loaded cold, so one-time pages keep recycling one frame
+// rather than evicting hot pages. cold starts out FALSE and stays set when a retry after
+// VICTIM_WRITTEN takes the freed victim
+static int claimAdmittedFrame(BufferPoolInfo *buffer_pool, PoolPartition *partition, int fileId, PageNumber pageNum, bool *cold){
+    if (partition->sketch == NULL || partition->availableSlots > 0) {
+        return claimFrame(buffer_pool, partition, TRUE);
+    }
+
+    int memory_address = chooseVictimFrame(buffer_pool, partition);
+    if (memory_address == NO_PAGE) {
+        return NO_PAGE;
+    }
+    BM_PageFrame *victim = &buffer_pool->frames[memory_address];
+    if (sketchEstimate(partition, fileId, pageNum) <= sketchEstimate(partition, victim->fileId, victim->pageNumber)) {
+        countEvent(&partition->admissionRejects);
+        *cold = TRUE;
+        if (partition->probationFrame != NO_PAGE && fixCountOf(buffer_pool, partition->probationFrame) == 0 &&
+            buffer_pool->frames[partition->probationFrame].pageClass == BM_PAGE_DATA) {
+            memory_address = partition->probationFrame;
+        }
+    }
+    return evictFrame(buffer_pool, partition, memory_address, TRUE);
+}
+
+// Counter indices of a page in the sketch rows: double hashing of a 64-bit page key hash
+static inline void sketchSlots(const PoolPartition *partition, int fileId, PageNumber pageNum, int slots[SKETCH_ROWS]) {
+    unsigned long long hash = (((unsigned long long)(unsigned int)fileId << 32) | (unsigned int)pageNum) * 0x9e3779b97f4a7c15ull;
+    unsigned int h1 = (unsigned int)(hash >> 32);
+    unsigned int h2 = (unsigned int)hash | 1;
+    for (int r = 0; r < SKETCH_ROWS; r++) {
+        slots[r] = r * (partition->sketchMask + 1) + (int)((h1 + r * h2) & (unsigned int)partition->sketchMask);
+    }
+}
+
+// Counter of a slot: the low nibble of its byte for even slots, the high one for odd
+static inline int sketchCounter(const PoolPartition *partition, int slot) {
+    return (partition->sketch[slot >> 1] >> ((slot & 1) * 4)) & SKETCH_MAX_COUNT;
+}
+
+// Count a pin in the sketch; every SKETCH_SAMPLE_PER_FRAME pins per frame all counters
+// are halved, so the estimates follow the recent pins. The caller holds the table latch
+static void sketchRecord(PoolPartition *partition, int fileId, PageNumber pageNum) {
+    int slots[SKETCH_ROWS];
+    sketchSlots(partition, fileId, pageNum, slots);
+    for (int r = 0; r < SKETCH_ROWS; r++) {
+        if (sketchCounter(partition, slots[r]) < SKETCH_MAX_COUNT) {
+            partition->sketch[slots[r] >> 1] += 1 << ((slots[r] & 1) * 4);
+        }
+    }
+
+    // Shifting a byte right halves both of its counters once the bit that crosses from
+    // the high counter into the low one is masked off
+    if (++partition->sketchPins >= SKETCH_SAMPLE_PER_FRAME * partition->numFrames) {
+        for (int i = 0; i < SKETCH_ROWS * (partition->sketchMask + 1) / 2; i++) {
+            partition->sketch[i] = (partition->sketch[i] >> 1) & 0x77;
+        }
+        partition->sketchPins /= 2;
+    }
+}
+
+// Pins of a page the sketch estimates, the smallest of its counters
+static int sketchEstimate(const PoolPartition *partition, int fileId, PageNumber pageNum) {
+    int slots[SKETCH_ROWS];
+    int estimate = SKETCH_MAX_COUNT;
+    sketchSlots(partition, fileId, pageNum, slots);
+    for (int r = 0; r < SKETCH_ROWS; r++) {
+        if (sketchCounter(partition, slots[r]) < estimate) {
+            estimate = sketchCounter(partition, slots[r]);
+        }
+    }
+    return estimate;
+}
+
+// Write a frame back if it is dirty; on failure it stays dirty. The caller holds the
+// partition's table latch
+static RC writeBackFrame(BufferPoolInfo *buffer_pool, PoolPartition *partition, int memory_address){
+    BM_PageFrame *frame = &buffer_pool->frames[memory_address];
+    if (!frame->isDirty) {
+        return RC_OK;
+    }
+
+    pthread_mutex_lock(&buffer_pool->ioLatch);
+    SM_FileHandle *fileHandle = &buffer_pool->files[frame->fileId].fileHandle;
+    RC status = ensureCapacity(frame->pageNumber + 1, fileHandle);
+    if (status == RC_OK) {
+        status = writeBlock(frame->pageNumber, fileHandle, frame->data);
+    }
+    pthread_mutex_unlock(&buffer_pool->ioLatch);
+    if (status != RC_OK) {
+        return RC_WRITE_FAILED;
+    }
+    clearDirty(buffer_pool, memory_address);
+    countEvent(&partition->writeCount);
+    return RC_OK;
+}
+
+// Write back an unpinned frame if it is dirty and take it out of the page table and
+// order; EVICTION_FAILED if the write fails, the frame stays buffered and dirty. With
+// mayUnlatch a dirty frame is written without the table latch: if it is still unpinned
+// and clean afterwards it is evicted onto the free list, either way the result is
+// VICTIM_WRITTEN and the caller looks its page up again before it claims a frame
+static int evictFrame(BufferPoolInfo *buffer_pool, PoolPartition *partition, int memory_address, bool mayUnlatch){
+    BM_PageFrame *frame = &buffer_pool->frames[memory_address];
+    bool dirty = frame->isDirty;
+    RC status;
+
+    if (dirty && mayUnlatch && writeVictimUnlatched(buffer_pool, partition, memory_address, &status)) {
+        if (status != RC_OK) {
+            return EVICTION_FAILED;
+        }
+        if (fixCountOf(buffer_pool, memory_address) == 0 && !frame->isDirty) {
+            dropVictim(buffer_pool, partition, memory_address, TRUE);
+            beginFrameWrite(&frame->version);
+            __atomic_store_n(&frame->pageNumber, NO_PAGE, __ATOMIC_RELAXED);
+            __atomic_store_n(&frame->fileId, NO_PAGE, __ATOMIC_RELAXED);
+            endFrameWrite(&frame->version);
+            frame->orderNext = partition->freeHead;
+            partition->freeHead = memory_address;
+            partition->availableSlots++;
+        }
+        return VICTIM_WRITTEN;
+    }
+
+    if (writeBackFrame(buffer_pool, partition, memory_address) != RC_OK) {
+        return EVICTION_FAILED;
+    }
+    dropVictim(buffer_pool, partition, memory_address, dirty);
+    return memory_address;
+}
+
+// Write back a dirty victim with its partition latch released, like flushDirtyFrames;
+// FALSE if it has to be written under the latch, because the I/O gate is closed or the
+// frame latch is taken. The victim stays fixed during the write and its shared frame
+// latch keeps exclusive writers out; the result of the write is left in status
+static bool writeVictimUnlatched(BufferPoolInfo *buffer_pool, PoolPartition *partition, int memory_address, RC *status){
+    BM_PageFrame *frame = &buffer_pool->frames[memory_address];
+
+    if (pthread_rwlock_tryrdlock(frame->latch) != 0) {
+        return FALSE;
+    }
+    if (!beginUnlatchedIo(buffer_pool)) {
+        pthread_mutex_unlock(&buffer_pool->ioLatch);
+        pthread_rwlock_unlock(frame->latch);
+        return FALSE;
+    }
+    __atomic_add_fetch(&frame->fixCount, 1, __ATOMIC_ACQ_REL);
+    clearDirty(buffer_pool, memory_address);
+    PageNumber pageNum = frame->pageNumber;
+    SM_FileHandle *fileHandle = &buffer_pool->files[frame->fileId].fileHandle;
+    pthread_mutex_unlock(&partition->tableLatch);
+
+    *status = ensureCapacity(pageNum + 1, fileHandle);
+    if (*status == RC_OK) {
+        *status = writeBlock(pageNum, fileHandle, frame->data);
+    }
+    pthread_mutex_unlock(&buffer_pool->ioLatch);
+    pthread_rwlock_unlock(frame->latch);
+
+    pthread_mutex_lock(&partition->tableLatch);
+    if (*status == RC_OK) {
+        countEvent(&partition->writeCount);
+    } else {
+        setDirty(buffer_pool, memory_address);
+    }
+    releasePin(buffer_pool, partition, memory_address);
+    endUnlatchedIo(buffer_pool);
+    return TRUE;
+}
+
+// Take a written-back victim out of the page table and order
+static void dropVictim(BufferPoolInfo *buffer_pool, PoolPartition *partition, int memory_address, bool dirty){
+    BM_PageFrame *frame = &buffer_pool->frames[memory_address];
+
+    if (dirty) {
+        countEvent(&partition->dirtyEvictionCount);
+    }
+    countEvent(&partition->evictionCount);
+    countClassFrame(partition, frame->pageClass, -1);
+    if (memory_address == partition->probationFrame) {
+        partition->probationFrame = NO_PAGE;
+    }
+    if (buffer_pool->policy.onEvict) {
+        buffer_pool->policy.onEvict(buffer_pool->policy.state, memory_address);
+    }
+    tierStore(buffer_pool->tier, frame->fileId, frame->pageNumber, frame->data);
+    unmapFrame(buffer_pool, partition, memory_address);
+    unlinkFromOrder(buffer_pool, partition, memory_address);
+}
+
+// Read a page straight into a claimed frame and fix it; pages past the end of the file
+// start out empty. Cold frames go to the front of the replacement order, next in line
+// for eviction, the others to the back. A page read from the file is mapped first and
+// read with the table latch released, with the frame marked loading and its latch held
+// in write mode, so pins of the page wait on the frame rather than the partition
+static void loadFrame(BufferPoolInfo *buffer_pool, PoolPartition *partition, int memory_address, int fileId, BM_PageHandle *const page, const PageNumber pageNum, bool cold){
+    BM_PageFrame *frame = &buffer_pool->frames[memory_address];
+    char *frame_data = frame->data;
+    bool unlatched = FALSE;
+
+    beginFrameWrite(&frame->version);
+    if (tierLoad(buffer_pool->tier, fileId, pageNum, frame_data)) {
+        installFrame(buffer_pool, partition, memory_address, fileId, pageNum, cold);
+    } else {
+        // The claimed frame is unpinned, so its latch is normally free; if not, read latched
+        if (pthread_rwlock_trywrlock(frame->latch) != 0) {
+            pthread_mutex_lock(&buffer_pool->ioLatch);
+        } else if (!(unlatched = beginUnlatchedIo(buffer_pool))) {
+            pthread_rwlock_unlock(frame->latch);
+        }
+        if (unlatched) {
+            __atomic_store_n(&frame->loading, TRUE, __ATOMIC_RELAXED);
+            installFrame(buffer_pool, partition, memory_address, fileId, pageNum, cold);
+            pthread_mutex_unlock(&partition->tableLatch);
+        }
+        RC read_code = readBlock(pageNum, &buffer_pool->files[fileId].fileHandle, frame_data);
+        pthread_mutex_unlock(&buffer_pool->ioLatch);
+        if (read_code != RC_OK) {
+            memset(frame_data, 0, PAGE_SIZE);
+        }
+
+        if (unlatched) {
+            __atomic_store_n(&frame->loading, FALSE, __ATOMIC_RELEASE);
+            endFrameWrite(&frame->version);
+            pthread_rwlock_unlock(frame->latch);
+            pthread_mutex_lock(&partition->tableLatch);
+            endUnlatchedIo(buffer_pool);
+        } else {
+            installFrame(buffer_pool, partition, memory_address, fileId, pageNum, cold);
+        }
+        countEvent(&partition->readCount);
+    }
+    if (!unlatched) {
+        endFrameWrite(&frame->version);
+    }
+
+    page->pageNum = pageNum;
+    page->data = frame_data;
+}
+
+// Enter a claimed frame into the replacement order and the page table and fix it; the
+// loader began a frame write and ends it once the data is read
+static void installFrame(BufferPoolInfo *buffer_pool, PoolPartition *partition, int memory_address, int fileId, const PageNumber pageNum, bool cold){
+    if (cold) {
+        prependToOrder(buffer_pool, partition, memory_address);
+    } else {
+        appendToOrder(buffer_pool, partition, memory_address);
+    }
+    updateBufferStats(buffer_pool, partition, memory_address, fileId, pageNum);
+    buffer_pool->frames[memory_address].pageClass = BM_PAGE_DATA;
+    buffer_pool->frames[memory_address].referenced = FALSE;
+    countClassFrame(partition, BM_PAGE_DATA, 1);
+    mapFrame(buffer_pool, partition, memory_address);
+    if (buffer_pool->policy.onLoad) {
+        buffer_pool->policy.onLoad(buffer_pool->policy.state, memory_address, cold);
+    }
+}
+
+// Put a claimed frame that will not be installed back on the free list, ending the
+// frame write and dropping the fix its claimer began with
+static void returnClaimedFrame(BufferPoolInfo *buffer_pool, PoolPartition *partition, int memory_address){
+    BM_PageFrame *frame = &buffer_pool->frames[memory_address];
+
+    __atomic_store_n(&frame->pageNumber, NO_PAGE, __ATOMIC_RELAXED);
+    __atomic_store_n(&frame->fileId, NO_PAGE, __ATOMIC_RELAXED);
+    __atomic_store_n(&frame->fixCount, 0, __ATOMIC_RELAXED);
+    endFrameWrite(&frame->version);
+    frame->orderNext = partition->freeHead;
+    partition->freeHead = memory_address;
+    partition->availableSlots++;
+    if (partition->waitingPins > 0) {
+        pthread_cond_broadcast(&partition->frameFreed);
+    }
+}
+
+
+/*****************************************
+*  Buffer Manager Interface Access Rings
+*****************************************/
+
+// Set up a ring of numFrames frames for a large scan; the ring starts empty and
+// collects frames as the scan misses
+RC initAccessRing(BM_BufferPool *const bm, BM_AccessRing *ring, int numFrames) {
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (ring == NULL) {
+        return RC_ERROR;
+    }
+
+    if (numFrames < 1) {
+        numFrames = 1;
+    }
+    if (numFrames > bm->numPages) {
+        numFrames = bm->numPages;
+    }
+
+    ring->frames = (int *)malloc(numFrames * sizeof(int));
+    ring->pageNums = (PageNumber *)malloc(numFrames * sizeof(PageNumber));
+    if (!ring->frames || !ring->pageNums) {
+        free(ring->frames);
+        free(ring->pageNums);
+        return RC_MEMORY_ALLOCATION_FAIL;
+    }
+    for (int i = 0; i < numFrames; i++) {
+        ring->frames[i] = NO_PAGE;
+        ring->pageNums[i] = NO_PAGE;
+    }
+    ring->numFrames = numFrames;
+    ring->current = 0;
+
+    return RC_OK;
+}
+
+// Pin a page for a scan: a miss recycles the ring's next frame if it still holds the
+// page the ring put there and nobody has it pinned, otherwise a frame is taken from
+// the pool as usual and joins the ring. Ring pages are loaded cold, so hot pages
+// of the pool are not pushed out by the scan
+RC pinPageInRing(BM_BufferPool *const bm, BM_AccessRing *ring, BM_PageHandle *const page, const PageNumber pageNum) {
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (ring == NULL || ring->frames == NULL) {
+        return pinPage(bm, page, pageNum);
+    }
+
+    PoolHandle *handle = bm->mgmtData;
+    BufferPoolInfo *bufferInfo = handle->pool;
+    PoolPartition *partition = partitionOf(bufferInfo, handle->fileId, pageNum);
+    pthread_rwlock_t *loadLatch = NULL;
+    bool recycled = FALSE;
+    int frame;
+    int memory_address;
+
+    tracePage(bufferInfo, handle->fileId, pageNum, TRACE_PIN);
+    pthread_mutex_lock(&partition->tableLatch);
+
+    // A victim written back without the table latch leaves the partition changed, start over
+    do {
+        if (pinBufferedFrame(bufferInfo, partition, handle->fileId, page, pageNum, &memory_address, &loadLatch)) {
+            pthread_mutex_unlock(&partition->tableLatch);
+            waitForLoad(loadLatch);
+            return RC_OK;
+        }
+        frame = ring->frames[ring->current];
+        if (frame != NO_PAGE && frame >= partition->firstFrame && frame < partition->firstFrame + partition->numFrames &&
+            bufferInfo->frames[frame].fileId == handle->fileId && bufferInfo->frames[frame].pageNumber == ring->pageNums[ring->current] &&
+            fixCountOf(bufferInfo, frame) == 0) {
+            recycled = TRUE;
+            frame = evictFrame(bufferInfo, partition, frame, TRUE);
+        } else {
+            frame = claimFrame(bufferInfo, partition, TRUE);
+        }
+    } while (frame == VICTIM_WRITTEN);
+
+    // A ring frame written back unlatched is taken from the free list on the retry
+    recycled = recycled && frame == ring->frames[ring->current];
+    if (frame == NO_PAGE && bufferInfo->pinTimeoutMillis > 0) {
+        frame = waitForFrame(bufferInfo, partition, handle->fileId, page, pageNum, &memory_address, &loadLatch);
+        if (frame == HIT_WHILE_WAITING) {
+            pthread_mutex_unlock(&partition->tableLatch);
+            waitForLoad(loadLatch);
+            return RC_OK;
+        }
+    }
+    countEvent(&partition->missCount);
+    if (frame == NO_PAGE || frame == EVICTION_FAILED) {
+        countEvent(&partition->pinFailures);
+        pthread_mutex_unlock(&partition->tableLatch);
+        return frame == NO_PAGE ? RC_BUFFERPOOL_FULL : RC_WRITE_FAILED;
+    }
+    if (recycled) {
+        countEvent(&partition->ringRecycles);
+    }
+
+    loadFrame(bufferInfo, partition, frame, handle->fileId, page, pageNum, TRUE);
+    pthread_mutex_unlock(&partition->tableLatch);
+
+    ring->frames[ring->current] = frame;
+    ring->pageNums[ring->current] = pageNum;
+    ring->current = (ring->current + 1) % ring->numFrames;
+    return RC_OK;
+}
+
+// Release a ring; its frames stay in the pool as ordinary cold frames
+RC freeAccessRing(BM_AccessRing *ring) {
+    if (ring == NULL) {
+        return RC_ERROR;
+    }
+    free(ring->frames);
+    free(ring->pageNums);
+    ring->frames = NULL;
+    ring->pageNums = NULL;
+    ring->numFrames = 0;
+    return RC_OK;
+}
+
+
+/*****************************************
+*  Buffer Manager Background Writer
+*****************************************/
+
+// Flag a frame as modified, waking the background writer at the high watermark;
+// the caller holds the frame's partition latch. The flag is stored atomically, like
+// the page number, for readers that do not hold the latch
+static void setDirty(BufferPoolInfo *bufferInfo, int frame) {
+    if (bufferInfo->frames[frame].isDirty) {
+        return;
+    }
+    __atomic_store_n(&bufferInfo->frames[frame].isDirty, TRUE, __ATOMIC_RELAXED);
+    int dirtyCount = __atomic_add_fetch(&bufferInfo->dirtyCount, 1, __ATOMIC_RELAXED);
+
+    if (bufferInfo->writerStarted && dirtyCount == bufferInfo->dirtyHigh) {
+        pthread_mutex_lock(&bufferInfo->writerLatch);
+        pthread_cond_signal(&bufferInfo->writerWake);
+        pthread_mutex_unlock(&bufferInfo->writerLatch);
+    }
+}
+
+// Flag a frame as clean again, the caller holds the frame's partition latch; stored
+// atomically like in setDirty
+static void clearDirty(BufferPoolInfo *bufferInfo, int frame) {
+    if (!bufferInfo->frames[frame].isDirty) {
+        return;
+    }
+    __atomic_store_n(&bufferInfo->frames[frame].isDirty, FALSE, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&bufferInfo->dirtyCount, 1, __ATOMIC_RELAXED);
+}
+
+// Take the I/O latch for a frame's I/O, the caller holds the frame's partition latch;
+// TRUE if the gate is open and the caller may release the partition latch during the
+// I/O, with the frame fixed, and must call endUnlatchedIo once it has the latch back
+static bool beginUnlatchedIo(BufferPoolInfo *bufferInfo) {
+    pthread_mutex_lock(&bufferInfo->ioLatch);
+    if (bufferInfo->ioGateClosers > 0) {
+        return FALSE;
+    }
+    bufferInfo->unlatchedIo++;
+    return TRUE;
+}
+
+static void endUnlatchedIo(BufferPoolInfo *bufferInfo) {
+    pthread_mutex_lock(&bufferInfo->ioLatch);
+    if (--bufferInfo->unlatchedIo == 0 && bufferInfo->ioGateClosers > 0) {
+        pthread_cond_broadcast(&bufferInfo->unlatchedIoDone);
+    }
+    pthread_mutex_unlock(&bufferInfo->ioLatch);
+}
+
+// Wait for the unlatched I/O in flight and keep new I/O under its partition latch until
+// openIoGate; called without any partition latch
+static void closeIoGate(BufferPoolInfo *bufferInfo) {
+    pthread_mutex_lock(&bufferInfo->ioLatch);
+    bufferInfo->ioGateClosers++;
+    while (bufferInfo->unlatchedIo > 0) {
+        pthread_cond_wait(&bufferInfo->unlatchedIoDone, &bufferInfo->ioLatch);
+    }
+    pthread_mutex_unlock(&bufferInfo->ioLatch);
+}
+
+static void openIoGate(BufferPoolInfo *bufferInfo) {
+    pthread_mutex_lock(&bufferInfo->ioLatch);
+    bufferInfo->ioGateClosers--;
+    pthread_mutex_unlock(&bufferInfo->ioLatch);
+}
+
+// Convert the watermark percentages to frame counts and start the writer thread;
+// also used to restart the writer after the pool was resized
+static RC startBackgroundWriter(BufferPoolInfo *bufferInfo, const BM_PoolOptions *options) {
+    bufferInfo->writerOptions = *options;
+    int highPercent = options->dirtyHighPercent > 100 ? 100 : options->dirtyHighPercent;
+    int lowPercent = options->dirtyLowPercent > 0 ? options->dirtyLowPercent : highPercent / 2;
+
+    if (lowPercent >= highPercent) {
+        lowPercent = highPercent - 1;
+    }
+    bufferInfo->dirtyHigh = (bufferInfo->maxPages * highPercent + 99) / 100;
+    bufferInfo->dirtyLow = bufferInfo->maxPages * lowPercent / 100;
+    if (bufferInfo->dirtyLow >= bufferInfo->dirtyHigh) {
+        bufferInfo->dirtyLow = bufferInfo->dirtyHigh - 1;
+    }
+
+    FlushCandidate *candidates = (FlushCandidate *)realloc(bufferInfo->flushCandidates, bufferInfo->maxPages * sizeof(FlushCandidate));
+    if (!candidates) {
+        return RC_MEMORY_ALLOCATION_FAIL;
+    }
+    bufferInfo->flushCandidates = candidates;
+    if (!bufferInfo->flushPage) {
+        bufferInfo->flushPage = (char *)malloc(PAGE_SIZE);
+        if (!bufferInfo->flushPage) {
+            return RC_MEMORY_ALLOCATION_FAIL;
+        }
+    }
+
+    bufferInfo->writerStop = FALSE;
+
+    if (pthread_create(&bufferInfo->writerThread, NULL, backgroundWriter, bufferInfo) != 0) {
+        return RC_ERROR;
+    }
+    bufferInfo->writerStarted = TRUE;
+    return RC_OK;
+}
+
+// Ask the writer thread to finish and wait for it
+static void stopBackgroundWriter(BufferPoolInfo *bufferInfo) {
+    if (!bufferInfo->writerStarted) {
+        return;
+    }
+    pthread_mutex_lock(&bufferInfo->writerLatch);
+    bufferInfo->writerStop = TRUE;
+    pthread_cond_signal(&bufferInfo->writerWake);
+    pthread_mutex_unlock(&bufferInfo->writerLatch);
+
+    pthread_join(bufferInfo->writerThread, NULL);
+    bufferInfo->writerStarted = FALSE;
+}
+
+// Writer thread: sleep below the high watermark, otherwise flush down to the low one
+static void *backgroundWriter(void *arg) {
+    BufferPoolInfo *bufferInfo = arg;
+
+    pthread_mutex_lock(&bufferInfo->writerLatch);
+    while (!bufferInfo->writerStop) {
+        if (__atomic_load_n(&bufferInfo->dirtyCount, __ATOMIC_RELAXED) < bufferInfo->dirtyHigh) {
+            pthread_cond_wait(&bufferInfo->writerWake, &bufferInfo->writerLatch);
+            continue;
+        }
+
+        pthread_mutex_unlock(&bufferInfo->writerLatch);
+        int flushed = flushDirtyFrames(bufferInfo);
+        pthread_mutex_lock(&bufferInfo->writerLatch);
+
+        // Everything left dirty is pinned: retry after a short pause instead of spinning
+        if (flushed == 0 && !bufferInfo->writerStop) {
+            struct timespec retryAt;
+            clock_gettime(CLOCK_REALTIME, &retryAt);
+            retryAt.tv_nsec += 10 * 1000 * 1000;
+            if (retryAt.tv_nsec >= 1000 * 1000 * 1000) {
+                retryAt.tv_sec++;
+                retryAt.tv_nsec -= 1000 * 1000 * 1000;
+            }
+            pthread_cond_timedwait(&bufferInfo->writerWake, &bufferInfo->writerLatch, &retryAt);
+        }
+    }
+    pthread_mutex_unlock(&bufferInfo->writerLatch);
+    return NULL;
+}
+
+static int compareFlushCandidates(const void *a, const void *b) {
+    const FlushCandidate *left = a;
+    const FlushCandidate *right = b;
+    if (left->fileId != right->fileId) {
+        return (left->fileId > right->fileId) - (left->fileId < right->fileId);
+    }
+    return (left->pageNum > right->pageNum) - (left->pageNum < right->pageNum);
+}
+
+// One writer pass: write unpinned dirty frames in file and page number order until
+// the low watermark is reached, returns the number of pages written. A page whose
+// write fails is marked dirty again and retried on a later pass
+static int flushDirtyFrames(BufferPoolInfo *bufferInfo) {
+    FlushCandidate *candidates = bufferInfo->flushCandidates;
+    int numCandidates = 0;
+    int flushed = 0;
+
+    for (int p = 0; p < bufferInfo->numPartitions; p++) {
+        PoolPartition *partition = &bufferInfo->partitions[p];
+
+        pthread_mutex_lock(&partition->tableLatch);
+        for (int i = partition->firstFrame; i < partition->firstFrame + partition->numFrames; i++) {
+            if (bufferInfo->frames[i].isDirty && fixCountOf(bufferInfo, i) == 0) {
+                candidates[numCandidates].fileId = bufferInfo->frames[i].fileId;
+                candidates[numCandidates].pageNum = bufferInfo->frames[i].pageNumber;
+                candidates[numCandidates].frame = i;
+                numCandidates++;
+            }
+        }
+        pthread_mutex_unlock(&partition->tableLatch);
+    }
+    qsort(candidates, numCandidates, sizeof(FlushCandidate), compareFlushCandidates);
+
+    for (int c = 0; c < numCandidates; c++) {
+        if (__atomic_load_n(&bufferInfo->dirtyCount, __ATOMIC_RELAXED) <= bufferInfo->dirtyLow) {
+            break;
+        }
+
+        int frame = candidates[c].frame;
+        PoolPartition *partition = partitionOf(bufferInfo, candidates[c].fileId, candidates[c].pageNum);
+
+        // The frame may have been replaced, pinned or flushed since it was picked
+        pthread_mutex_lock(&partition->tableLatch);
+        if (bufferInfo->frames[frame].pageNumber != candidates[c].pageNum || bufferInfo->frames[frame].fileId != candidates[c].fileId ||
+            !bufferInfo->frames[frame].isDirty || fixCountOf(bufferInfo, frame) != 0) {
+            pthread_mutex_unlock(&partition->tableLatch);
+            continue;
+        }
+
+        // Copy the page and mark it clean, so updates made during the write dirty it
+        // again; the I/O latch is taken before the partition latch is released, so a
+        // re-read of the page cannot overtake this write. The frame stays fixed until
+        // the write is done, so a failed write still finds the page to mark dirty
+        memcpy(bufferInfo->flushPage, bufferInfo->frames[frame].data, PAGE_SIZE);
+        clearDirty(bufferInfo, frame);
+        bool unlatched = beginUnlatchedIo(bufferInfo);
+        if (unlatched) {
+            __atomic_add_fetch(&bufferInfo->frames[frame].fixCount, 1, __ATOMIC_ACQ_REL);
+            pthread_mutex_unlock(&partition->tableLatch);
+        }
+
+        SM_FileHandle *fileHandle = &bufferInfo->files[candidates[c].fileId].fileHandle;
+        RC status = ensureCapacity(candidates[c].pageNum + 1, fileHandle);
+        if (status == RC_OK) {
+            status = writeBlock(candidates[c].pageNum, fileHandle, bufferInfo->flushPage);
+        }
+        pthread_mutex_unlock(&bufferInfo->ioLatch);
+
+        if (unlatched) {
+            pthread_mutex_lock(&partition->tableLatch);
+        }
+        if (status == RC_OK) {
+            countEvent(&partition->writeCount);
+            countEvent(&partition->flushCount);
+            flushed++;
+        } else {
+            setDirty(bufferInfo, frame);
+        }
+        if (unlatched) {
+            releasePin(bufferInfo, partition, frame);
+        }
+        pthread_mutex_unlock(&partition->tableLatch);
+        if (unlatched) {
+            endUnlatchedIo(bufferInfo);
+        }
+    }
+    return flushed;
+}
+
+
+/*****************************************
+*  Victim Tier
+*****************************************/
+
+// Page codec of the victim tier, tuned for record pages that are mostly zero padding.
+// It works on 8-byte words: a control byte 128 + n - 1 stands for n zero words, a
+// control byte n - 1 is followed by n literal words (n up to 128). Returns the
+// compressed size, 0 if it would exceed capacity
+#define CODEC_WORDS (PAGE_SIZE / 8)
+_Static_assert(PAGE_SIZE % 8 == 0, "the victim tier codec works on 8-byte words");
+
+// Words are moved with fixed-size memcpy calls, which compile to single loads and
+// stores; record pages break into many short runs, too short for a libc call each
+static inline unsigned long long loadWord(const void *from) {
+    unsigned long long value;
+    memcpy(&value, from, 8);
+    return value;
+}
+
+static inline void storeWord(void *to, unsigned long long value) {
+    memcpy(to, &value, 8);
+}
+
+static int compressPage(const char *page, unsigned char *out, int capacity) {
+    int size = 0;
+    int word = 0;
+
+    while (word < CODEC_WORDS) {
+        int start = word;
+        if (loadWord(page + word * 8) == 0) {
+            while (word < CODEC_WORDS && word - start < 128 && loadWord(page + word * 8) == 0) {
+                word++;
+            }
+            if (size + 1 > capacity) {
+                return 0;
+            }
+            out[size++] = (unsigned char)(128 + word - start - 1);
+        } else {
+            int control = size++;
+            unsigned long long value;
+            while (word < CODEC_WORDS && word - start < 128 && (value = loadWord(page + word * 8)) != 0) {
+                if (size + 8 > capacity) {
+                    return 0;
+                }
+                storeWord(out + size, value);
+                size += 8;
+                word++;
+            }
+            out[control] = (unsigned char)(word - start - 1);
+        }
+    }
+    return size;
+}
+
+static void decompressPage(const unsigned char *in, int size, char *page) {
+    int i = 0;
+    char *end;
+
+    while (i < size) {
+        int control = in[i++];
+        end = page + ((control & 127) + 1) * 8;
+        if (control >= 128) {
+            for (; page < end; page += 8) {
+                storeWord(page, 0);
+            }
+        } else {
+            for (; page < end; page += 8, i += 8) {
+                storeWord(page, loadWord(in + i));
+            }
+        }
+    }
+}
+
+static VictimTier *createTier(long long budget) {
+    VictimTier *tier = (VictimTier *)calloc(1, sizeof(VictimTier));
+    if (tier == NULL) {
+        return NULL;
+    }
+
+    int bucketCount = 64;
+    while (bucketCount < budget / TIER_BYTES_PER_BUCKET) {
+        bucketCount <<= 1;
+    }
+    tier->buckets = (TierEntry **)calloc(bucketCount, sizeof(TierEntry *));
+    if (tier->buckets == NULL) {
+        free(tier);
+        return NULL;
+    }
+    tier->bucketMask = bucketCount - 1;
+    tier->budget = budget;
+    pthread_mutex_init(&tier->latch, NULL);
+    return tier;
+}
+
+static void freeTier(VictimTier *tier) {
+    if (tier == NULL) {
+        return;
+    }
+    for (TierEntry *entry = tier->lruHead, *next; entry != NULL; entry = next) {
+        next = entry->lruNext;
+        free(entry);
+    }
+    free(tier->buckets);
+    pthread_mutex_destroy(&tier->latch);
+    free(tier);
+}
+
+// Unlink an entry from its hash chain and the LRU list and free it; the caller holds the tier latch
+static void removeTierEntry(VictimTier *tier, TierEntry *entry) {
+    TierEntry **link = &tier->buckets[pageKeyHash(entry->fileId, entry->pageNum) & (unsigned int)tier->bucketMask];
+    while (*link != entry) {
+        link = &(*link)->hashNext;
+    }
+    *link = entry->hashNext;
+
+    if (entry->lruPrev != NULL) {
+        entry->lruPrev->lruNext = entry->lruNext;
+    } else {
+        tier->lruHead = entry->lruNext;
+    }
+    if (entry->lruNext != NULL) {
+        entry->lruNext->lruPrev = entry->lruPrev;
+    } else {
+        tier->lruTail = entry->lruPrev;
+    }
+
+    tier->bytes -= sizeof(TierEntry) + entry->size;
+    tier->pages--;
+    free(entry);
+}
+
+// Entry of a page, NULL if the tier does not hold it; the caller holds the tier latch
+static TierEntry *findTierEntry(VictimTier *tier, int fileId, PageNumber pageNum) {
+    TierEntry *entry = tier->buckets[pageKeyHash(fileId, pageNum) & (unsigned int)tier->bucketMask];
+    while (entry != NULL && (entry->pageNum != pageNum || entry->fileId != fileId)) {
+        entry = entry->hashNext;
+    }
+    return entry;
+}
+
+// Keep a page that leaves the frames, clean, in the tier if it compresses well enough,
+// dropping the least recently stored pages to stay within the budget
+static void tierStore(VictimTier *tier, int fileId, PageNumber pageNum, const char *page) {
+    unsigned char compressed[TIER_MAX_COMPRESSED];
+
+    if (tier == NULL) {
+        return;
+    }
+    int size = compressPage(page, compressed, TIER_MAX_COMPRESSED);
+    TierEntry *entry = size > 0 && (long long)(sizeof(TierEntry) + size) <= tier->budget
+                       ? (TierEntry *)malloc(sizeof(TierEntry) + size) : NULL;
+
+    pthread_mutex_lock(&tier->latch);
+    TierEntry *old = findTierEntry(tier, fileId, pageNum);
+    if (old != NULL) {
+        removeTierEntry(tier, old);
+    }
+    if (entry != NULL) {
+        while (tier->bytes + (long long)(sizeof(TierEntry) + size) > tier->budget) {
+            removeTierEntry(tier, tier->lruHead);
+        }
+        entry->fileId = fileId;
+        entry->pageNum = pageNum;
+        entry->size = size;
+        memcpy(entry->data, compressed, size);
+
+        unsigned int bucket = pageKeyHash(fileId, pageNum) & (unsigned int)tier->bucketMask;
+        entry->hashNext = tier->buckets[bucket];
+        tier->buckets[bucket] = entry;
+        entry->lruPrev = tier->lruTail;
+        entry->lruNext = NULL;
+        if (tier->lruTail != NULL) {
+            tier->lruTail->lruNext = entry;
+        } else {
+            tier->lruHead = entry;
+        }
+        tier->lruTail = entry;
+        tier->bytes += sizeof(TierEntry) + size;
+        tier->pages++;
+        tier->stores++;
+    }
+    pthread_mutex_unlock(&tier->latch);
+}
+
+// Move a page from the tier into frame data; FALSE if the tier does not hold it
+static bool tierLoad(VictimTier *tier, int fileId, PageNumber pageNum, char *page) {
+    if (tier == NULL) {
+        return FALSE;
+    }
+
+    pthread_mutex_lock(&tier->latch);
+    TierEntry *entry = findTierEntry(tier, fileId, pageNum);
+    if (entry != NULL) {
+        decompressPage(entry->data, entry->size, page);
+        removeTierEntry(tier, entry);
+        tier->hits++;
+    }
+    pthread_mutex_unlock(&tier->latch);
+    return entry != NULL;
+}
+
+// Forget a page that was loaded into a frame some other way
+static void tierDrop(VictimTier *tier, int fileId, PageNumber pageNum) {
+    if (tier == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&tier->latch);
+    TierEntry *entry = findTierEntry(tier, fileId, pageNum);
+    if (entry != NULL) {
+        removeTierEntry(tier, entry);
+    }
+    pthread_mutex_unlock(&tier->latch);
+}
+
+// Forget all pages of a file that is closed
+static void tierDropFile(VictimTier *tier, int fileId) {
+    if (tier == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&tier->latch);
+    for (TierEntry *entry = tier->lruHead, *next; entry != NULL; entry = next) {
+        next = entry->lruNext;
+        if (entry->fileId == fileId) {
+            removeTierEntry(tier, entry);
+        }
+    }
+    pthread_mutex_unlock(&tier->latch);
+}
+
+
+/*****************************************
+*  Buffer Manager Interface Adaptive Policy
+*****************************************/
+
+// Frames of the shadow caches for a pool of numFrames frames (see ADAPT_SHADOW_DIVISOR)
+static int shadowFrames(int numFrames) {
+    int capacity = numFrames / ADAPT_SHADOW_DIVISOR;
+    if (capacity < ADAPT_MIN_SHADOW_FRAMES) {
+        capacity = numFrames < ADAPT_MIN_SHADOW_FRAMES ? numFrames : ADAPT_MIN_SHADOW_FRAMES;
+    }
+    return capacity < ADAPT_MAX_SHADOW_FRAMES ? capacity : ADAPT_MAX_SHADOW_FRAMES;
+}
+
+// 64-bit hash of a page key; its top 16 bits decide whether the page is sampled
+static inline unsigned long long shadowHash(unsigned long long key) {
+    return (key ^ (key >> 29)) * 0xbf58476d1ce4e5b9ull;
+}
+
+static AdaptiveState *createAdaptive(int numFrames) {
+    static const ReplacementStrategy strategies[ADAPT_NUM_SHADOWS] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LRU_K };
+    AdaptiveState *adaptive = (AdaptiveState *)calloc(1, sizeof(AdaptiveState));
+    int bucketCount = 2;
+    if (adaptive == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&adaptive->latch, NULL);
+    adaptive->pending = NO_PAGE;
+
+    // Shadows are allocated for the largest sample, a resize only changes how much is used
+    while (bucketCount < 2 * ADAPT_MAX_SHADOW_FRAMES) {
+        bucketCount <<= 1;
+    }
+    for (int i = 0; i < ADAPT_NUM_SHADOWS; i++) {
+        ShadowCache *shadow = &adaptive->shadows[i];
+        shadow->strategy = strategies[i];
+        shadow->keys = (unsigned long long *)malloc(ADAPT_MAX_SHADOW_FRAMES * sizeof(unsigned long long));
+        shadow->hashNext = (int *)malloc(ADAPT_MAX_SHADOW_FRAMES * sizeof(int));
+        shadow->orderPrev = (int *)malloc(ADAPT_MAX_SHADOW_FRAMES * sizeof(int));
+        shadow->orderNext = (int *)malloc(ADAPT_MAX_SHADOW_FRAMES * sizeof(int));
+        shadow->referenced = (bool *)malloc(ADAPT_MAX_SHADOW_FRAMES * sizeof(bool));
+        shadow->buckets = (int *)malloc(bucketCount * sizeof(int));
+        shadow->bucketMask = bucketCount - 1;
+        if (!shadow->keys || !shadow->hashNext || !shadow->orderPrev || !shadow->orderNext || !shadow->referenced ||
+            !shadow->buckets) {
+            freeAdaptive(adaptive);
+            return NULL;
+        }
+    }
+    resetAdaptive(adaptive, numFrames);
+    return adaptive;
+}
+
+static void freeAdaptive(AdaptiveState *adaptive) {
+    if (adaptive == NULL) {
+        return;
+    }
+    for (int i = 0; i < ADAPT_NUM_SHADOWS; i++) {
+        free(adaptive->shadows[i].keys);
+        free(adaptive->shadows[i].hashNext);
+        free(adaptive->shadows[i].orderPrev);
+        free(adaptive->shadows[i].orderNext);
+        free(adaptive->shadows[i].referenced);
+        free(adaptive->shadows[i].buckets);
+    }
+    pthread_mutex_destroy(&adaptive->latch);
+    free(adaptive);
+}
+
+// Empty the shadow caches and size the sample for a pool of numFrames frames
+static void resetAdaptive(AdaptiveState *adaptive, int numFrames) {
+    pthread_mutex_lock(&adaptive->latch);
+    adaptive->capacity = shadowFrames(numFrames);
+    adaptive->sampleThreshold = (unsigned int)((65536LL * adaptive->capacity) / numFrames);
+    adaptive->epochLength = ADAPT_EPOCH_PER_FRAME * adaptive->capacity;
+    adaptive->epochPins = 0;
+    for (int i = 0; i < ADAPT_NUM_SHADOWS; i++) {
+        ShadowCache *shadow = &adaptive->shadows[i];
+        for (int b = 0; b <= shadow->bucketMask; b++) {
+            shadow->buckets[b] = NO_PAGE;
+        }
+        shadow->used = 0;
+        shadow->head = NO_PAGE;
+        shadow->tail = NO_PAGE;
+        shadow->onceTail = NO_PAGE;
+        shadow->epochHits = 0;
+    }
+    pthread_mutex_unlock(&adaptive->latch);
+}
+
+// Take a slot out of a shadow's order
+static void shadowUnlink(ShadowCache *shadow, int slot) {
+    int prev = shadow->orderPrev[slot];
+    int next = shadow->orderNext[slot];
+
+    if (prev != NO_PAGE) {
+        shadow->orderNext[prev] = next;
+    } else {
+        shadow->head = next;
+    }
+    if (next != NO_PAGE) {
+        shadow->orderPrev[next] = prev;
+    } else {
+        shadow->tail = prev;
+    }
+}
+
+// Insert a slot behind another one of a shadow's order, at its head if after is NO_PAGE
+static void shadowInsert(ShadowCache *shadow, int after, int slot) {
+    int next = after != NO_PAGE ? shadow->orderNext[after] : shadow->head;
+
+    shadow->orderPrev[slot] = after;
+    shadow->orderNext[slot] = next;
+    if (after != NO_PAGE) {
+        shadow->orderNext[after] = slot;
+    } else {
+        shadow->head = slot;
+    }
+    if (next != NO_PAGE) {
+        shadow->orderPrev[next] = slot;
+    } else {
+        shadow->tail = slot;
+    }
+}
+
+// Replay one pin on a shadow cache the way the built-in policy of its strategy handles
+// it in the pool; pins are not simulated, every slot can be replaced
+static void shadowAccess(ShadowCache *shadow, int capacity, unsigned long long key, unsigned long long hash) {
+    int bucket = (int)(hash & (unsigned long long)shadow->bucketMask);
+    int slot = shadow->buckets[bucket];
+
+    while (slot != NO_PAGE && shadow->keys[slot] != key) {
+        slot = shadow->hashNext[slot];
+    }
+    if (slot != NO_PAGE) {
+        shadow->epochHits++;
+        if (shadow->strategy == RS_CLOCK) {
+            shadow->referenced[slot] = TRUE;
+        } else if (shadow->strategy != RS_FIFO) {
+            if (shadow->strategy == RS_LRU_K && !shadow->referenced[slot]) {
+                if (slot == shadow->onceTail) {
+                    shadow->onceTail = shadow->orderPrev[slot];
+                }
+                shadow->referenced[slot] = TRUE;
+            }
+            shadowUnlink(shadow, slot);
+            shadowInsert(shadow, shadow->tail, slot);
+        }
+        return;
+    }
+
+    if (shadow->used < capacity) {
+        slot = shadow->used++;
+    } else {
+        slot = shadow->head;
+        while (shadow->strategy == RS_CLOCK && shadow->referenced[slot]) {
+            shadow->referenced[slot] = FALSE;
+            shadowUnlink(shadow, slot);
+            shadowInsert(shadow, shadow->tail, slot);
+            slot = shadow->head;
+        }
+        if (slot == shadow->onceTail) {
+            shadow->onceTail = NO_PAGE;
+        }
+        shadowUnlink(shadow, slot);
+        int *link = &shadow->buckets[shadowHash(shadow->keys[slot]) & (unsigned long long)shadow->bucketMask];
+        while (*link != slot) {
+            link = &shadow->hashNext[*link];
+        }
+        *link = shadow->hashNext[slot];
+    }
+
+    shadow->keys[slot] = key;
+    shadow->referenced[slot] = FALSE;
+    shadow->hashNext[slot] = shadow->buckets[bucket];
+    shadow->buckets[bucket] = slot;
+    if (shadow->strategy == RS_LRU_K) {
+        shadowInsert(shadow, shadow->onceTail, slot);
+        shadow->onceTail = slot;
+    } else {
+        shadowInsert(shadow, shadow->tail, slot);
+    }
+}
+
+// Replay a pin of a sampled page on every shadow cache and, at the end of an epoch, make
+// the strategy with the most shadow hits pending if it beats the one in use by enough.
+// A strategy without a shadow (LFU) gives way to the best one. The caller holds the
+// partition's table latch
+static void adaptiveRecord(BufferPoolInfo *bufferInfo, int fileId, PageNumber pageNum) {
+    AdaptiveState *adaptive = bufferInfo->adaptive;
+    unsigned long long key = ((unsigned long long)(unsigned int)fileId << 32) | (unsigned int)pageNum;
+    unsigned long long hash = shadowHash(key);
+
+    if ((unsigned int)(hash >> 48) >= adaptive->sampleThreshold) {
+        return;
+    }
+
+    pthread_mutex_lock(&adaptive->latch);
+    for (int i = 0; i < ADAPT_NUM_SHADOWS; i++) {
+        shadowAccess(&adaptive->shadows[i], adaptive->capacity, key, hash);
+    }
+    if (++adaptive->epochPins >= adaptive->epochLength) {
+        int current = __atomic_load_n(&bufferInfo->strategyType, __ATOMIC_RELAXED);
+        long long currentHits = -1;
+        int best = 0;
+
+        for (int i = 0; i < ADAPT_NUM_SHADOWS; i++) {
+            if (adaptive->shadows[i].strategy == current) {
+                currentHits = adaptive->shadows[i].epochHits;
+            }
+            if (adaptive->shadows[i].epochHits > adaptive->shadows[best].epochHits) {
+                best = i;
+            }
+        }
+        if (adaptive->shadows[best].strategy != current &&
+            (currentHits < 0 || (adaptive->shadows[best].epochHits - currentHits) * 100 >= ADAPT_MIN_GAIN_PERCENT * adaptive->epochPins)) {
+            __atomic_store_n(&adaptive->pending, adaptive->shadows[best].strategy, __ATOMIC_RELEASE);
+        }
+
+        adaptive->epochPins = 0;
+        for (int i = 0; i < ADAPT_NUM_SHADOWS; i++) {
+            adaptive->shadows[i].epochHits = 0;
+        }
+    }
+    pthread_mutex_unlock(&adaptive->latch);
+}
+
+// Switch the pool to the pending strategy with every partition latched. The pages keep
+// their place in the replacement order and lose their reference bits, so under LRU-K they
+// all count as referenced once
+static void switchPendingStrategy(BufferPoolInfo *bufferInfo) {
+    AdaptiveState *adaptive = bufferInfo->adaptive;
+    int p;
+
+    if (__atomic_load_n(&adaptive->pending, __ATOMIC_ACQUIRE) == NO_PAGE) {
+        return;
+    }
+    for (p = 0; p < bufferInfo->numPartitions; p++) {
+        pthread_mutex_lock(&bufferInfo->partitions[p].tableLatch);
+    }
+
+    // Another pin may have switched already
+    int strategy = __atomic_exchange_n(&adaptive->pending, NO_PAGE, __ATOMIC_ACQ_REL);
+
+    if (strategy != NO_PAGE && strategy != bufferInfo->strategyType) {
+        __atomic_store_n(&bufferInfo->strategyType, strategy, __ATOMIC_RELAXED);
+        setPolicy(bufferInfo, NULL);
+        for (p = 0; p < bufferInfo->numPartitions; p++) {
+            PoolPartition *partition = &bufferInfo->partitions[p];
+            for (int f = partition->orderHead; f != NO_PAGE; f = bufferInfo->frames[f].orderNext) {
+                bufferInfo->frames[f].referenced = FALSE;
+            }
+            partition->onceTail = partition->orderTail;
+        }
+        __atomic_store_n(&adaptive->switches, adaptive->switches + 1, __ATOMIC_RELAXED);
+
+        pthread_mutex_lock(&bufferInfo->ioLatch);
+        for (PoolHandle *handle = bufferInfo->handles; handle != NULL; handle = handle->next) {
+            __atomic_store_n(&handle->bufferPool->strategy, strategy, __ATOMIC_RELAXED);
+        }
+        pthread_mutex_unlock(&bufferInfo->ioLatch);
+    }
+
+    for (p = bufferInfo->numPartitions - 1; p >= 0; p--) {
+        pthread_mutex_unlock(&bufferInfo->partitions[p].tableLatch);
+    }
+}
+
+
+/*****************************************
+*  Buffer Manager Interface Prefetching
+*****************************************/
 
-//  static helper methods
-static RC writeDirtyPagesToDisk(BM_BufferPool *const bufferPool);
-static RC releaseBufferMemory(BM_BufferPool *const bufferPool);
-static void shiftAccessOrder(int startIndex, int end, BufferPoolInfo *bufferPoolData, int newPageNumber);
-static void updateBufferStats(BufferPoolInfo *bufferPoolData, int bufferIndex, int pageNumber);
+// Queue pages for the prefetcher thread, starting it on first use; pageNums == NULL
+// queues the range [startPage, startPage + numPages). Requests that do not fit in
+// the queue are dropped, prefetching is only a hint
+static RC queuePrefetch(BufferPoolInfo *bufferInfo, int fileId, const PageNumber *pageNums, PageNumber startPage, int numPages) {
+    pthread_mutex_lock(&bufferInfo->prefetchLatch);
+    if (!bufferInfo->prefetchStarted) {
+        bufferInfo->prefetchStop = FALSE;
+        if (pthread_create(&bufferInfo->prefetchThread, NULL, prefetcher, bufferInfo) != 0) {
+            pthread_mutex_unlock(&bufferInfo->prefetchLatch);
+            return RC_ERROR;
+        }
+        bufferInfo->prefetchStarted = TRUE;
+    }
 
-// Initialize the buffer pool
-RC initBufferPool(BM_BufferPool *const bufferPool, const char *const pageFileName, const int pageCount, ReplacementStrategy strategy, void *strategyData)
-{
-    if (bufferPool == NULL || pageFileName == NULL || pageCount <= 0) {
-        return RC_ERROR;
+    for (int i = 0; i < numPages && bufferInfo->prefetchCount < bufferInfo->maxPages; i++) {
+        PageNumber pageNum = pageNums ? pageNums[i] : startPage + i;
+        if (pageNum < 0) {
+            continue;
+        }
+        int slot = (bufferInfo->prefetchHead + bufferInfo->prefetchCount) % bufferInfo->maxPages;
+        bufferInfo->prefetchQueue[slot].fileId = fileId;
+        bufferInfo->prefetchQueue[slot].pageNum = pageNum;
+        bufferInfo->prefetchCount++;
     }
+    pthread_cond_signal(&bufferInfo->prefetchWake);
+    pthread_mutex_unlock(&bufferInfo->prefetchLatch);
 
-    SM_FileHandle file;
-    BufferPoolInfo *bufferPoolInfo;
-    int status, i;
+    return RC_OK;
+}
 
-    // Open the page file
-    status = openPageFile((char *)pageFileName, &file);
-    if (status != RC_OK) {
-        return status;
+// Load the listed pages into unpinned frames in the background
+RC prefetchPages(BM_BufferPool *const bm, const PageNumber *pageNums, int numPages) {
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
     }
-
-    // Allocate memory for the buffer pool
-    bufferPoolInfo = (BufferPoolInfo *)calloc(1, sizeof(BufferPoolInfo));
-    if (!bufferPoolInfo) {
-        return RC_MEMORY_ALLOCATION_FAIL;
+    if (pageNums == NULL || numPages < 0) {
+        return RC_ERROR;
     }
 
-    bufferPoolInfo->maxPages = pageCount;
-    bufferPoolInfo->pageDataBuffer = (char *)calloc(pageCount * PAGE_SIZE, sizeof(char));
-    bufferPoolInfo->readCount = 0;
-    bufferPoolInfo->writeCount = 0;
-    bufferPoolInfo->accessOrder = (int *)calloc(pageCount, sizeof(int));
-    bufferPoolInfo->dirtyFlags = (bool *)calloc(pageCount, sizeof(bool));
-    bufferPoolInfo->availableSlots = pageCount;
-    bufferPoolInfo->fileHandle = file;
-    bufferPoolInfo->pageNumbers = (int *)calloc(pageCount, sizeof(int));
-    bufferPoolInfo->pageFixCount = (int *)calloc(pageCount, sizeof(int));
-    bufferPoolInfo->strategyType = strategy;
+    PoolHandle *handle = bm->mgmtData;
+    return queuePrefetch(handle->pool, handle->fileId, pageNums, 0, numPages);
+}
 
-    // Initialize array values
-    for (i = 0; i < pageCount; i++) {
-        bufferPoolInfo->dirtyFlags[i] = FALSE;
-        bufferPoolInfo->pageFixCount[i] = 0;
-        bufferPoolInfo->pageNumbers[i] = NO_PAGE;
-        bufferPoolInfo->accessOrder[i] = NO_PAGE;
+// Load the consecutive pages [startPage, startPage + numPages) in the background
+RC prefetchRange(BM_BufferPool *const bm, const PageNumber startPage, int numPages) {
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (startPage < 0 || numPages < 0) {
+        return RC_ERROR;
     }
 
-    // Initialize BM_BufferPool structure
-    if (bufferPool != NULL) {
-        bufferPool->pageFile = pageFileName ? strdup(pageFileName) : NULL;
-        bufferPool->numPages = pageCount;
-        bufferPool->strategy = strategy;
-        bufferPool->mgmtData = bufferPoolInfo;
+    PoolHandle *handle = bm->mgmtData;
+    return queuePrefetch(handle->pool, handle->fileId, NULL, startPage, numPages);
+}
+
+// Drop pending prefetches and wait for the prefetcher thread to finish
+static void stopPrefetcher(BufferPoolInfo *bufferInfo) {
+    pthread_mutex_lock(&bufferInfo->prefetchLatch);
+    if (!bufferInfo->prefetchStarted) {
+        pthread_mutex_unlock(&bufferInfo->prefetchLatch);
+        return;
     }
+    bufferInfo->prefetchStop = TRUE;
+    bufferInfo->prefetchCount = 0;
+    pthread_cond_signal(&bufferInfo->prefetchWake);
+    pthread_mutex_unlock(&bufferInfo->prefetchLatch);
 
-    return RC_OK;
+    pthread_join(bufferInfo->prefetchThread, NULL);
+    bufferInfo->prefetchStarted = FALSE;
 }
 
-// Shut down the buffer pool
-RC shutdownBufferPool(BM_BufferPool *const bufferPool)
-{
-    if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
-        return RC_ERROR;
+// Load a run of consecutive pages of one file with a single readBlocks call straight into
+// the frames claimed for them, leaving them unpinned. Pages already buffered, or whose
+// partition has every frame pinned or cannot write its victim back, are read into
+// scratch and dropped. The claimed frames are fixed and their versions odd until they
+// are installed, and the read runs without the partition latches while the I/O gate
+// is open; latched has a flag per partition. If the read fails, the frames go back
+// to their free lists
+static void prefetchRun(BufferPoolInfo *bufferInfo, int fileId, PageNumber startPage, int numPages, bool *latched) {
+    int frames[PREFETCH_BATCH_PAGES];
+    SM_PageHandle pages[PREFETCH_BATCH_PAGES];
+    char scratch[PAGE_SIZE];
+    int claimed = 0;
+    bool unlatched = FALSE;
+    int p, i;
+
+    // Latch the partitions of the run in ascending order, as the pool-wide latchers do
+    memset(latched, 0, bufferInfo->numPartitions * sizeof(bool));
+    for (i = 0; i < numPages; i++) {
+        latched[partitionOf(bufferInfo, fileId, startPage + i) - bufferInfo->partitions] = TRUE;
+    }
+    for (p = 0; p < bufferInfo->numPartitions; p++) {
+        if (latched[p]) {
+            pthread_mutex_lock(&bufferInfo->partitions[p].tableLatch);
+        }
     }
 
-    BufferPoolInfo *bufferInfo = bufferPool->mgmtData;
+    for (i = 0; i < numPages; i++) {
+        PoolPartition *partition = partitionOf(bufferInfo, fileId, startPage + i);
+        frames[i] = NO_PAGE;
+        if (lookupFrame(bufferInfo, partition, fileId, startPage + i) == NO_PAGE) {
+            // The other partitions of the run stay latched, so no victim is written unlatched
+            frames[i] = claimFrame(bufferInfo, partition, FALSE);
+        }
+        if (frames[i] == EVICTION_FAILED) {
+            frames[i] = NO_PAGE;
+        }
+        if (frames[i] != NO_PAGE) {
+            // A fix keeps later claims of the run from choosing the frame again
+            __atomic_store_n(&bufferInfo->frames[frames[i]].fixCount, 1, __ATOMIC_RELAXED);
+            pages[i] = bufferInfo->frames[frames[i]].data;
+            beginFrameWrite(&bufferInfo->frames[frames[i]].version);
+            claimed++;
+        } else {
+            pages[i] = scratch;
+        }
+    }
 
-    // Check for pinned pages
-    for (int i = 0; i < bufferInfo->maxPages; i++) {
-        if (bufferInfo->pageFixCount[i] != 0) {
-            return RC_BUFFERPOOL_IN_USE;
+    if (claimed > 0) {
+        unlatched = beginUnlatchedIo(bufferInfo);
+        for (p = bufferInfo->numPartitions - 1; unlatched && p >= 0; p--) {
+            if (latched[p]) {
+                pthread_mutex_unlock(&bufferInfo->partitions[p].tableLatch);
+            }
+        }
+
+        // Pages past the end of the file start out empty
+        SM_FileHandle *fileHandle = &bufferInfo->files[fileId].fileHandle;
+        int readable = fileHandle->totalNumPages - startPage;
+        readable = readable < 0 ? 0 : (readable > numPages ? numPages : readable);
+        RC read_code = readable > 0 ? readBlocks(startPage, readable, fileHandle, pages) : RC_OK;
+        pthread_mutex_unlock(&bufferInfo->ioLatch);
+
+        for (p = 0; unlatched && p < bufferInfo->numPartitions; p++) {
+            if (latched[p]) {
+                pthread_mutex_lock(&bufferInfo->partitions[p].tableLatch);
+            }
+        }
+
+        // A pin may have loaded one of the pages while the latches were released; its
+        // frame goes back like those of a failed read, in reverse so the free lists
+        // keep their order
+        for (i = numPages - 1; i >= 0; i--) {
+            if (frames[i] == NO_PAGE) {
+                continue;
+            }
+            PoolPartition *partition = partitionOf(bufferInfo, fileId, startPage + i);
+            if (read_code != RC_OK || lookupFrame(bufferInfo, partition, fileId, startPage + i) != NO_PAGE) {
+                returnClaimedFrame(bufferInfo, partition, frames[i]);
+                frames[i] = NO_PAGE;
+            }
+        }
+        for (i = 0; i < numPages; i++) {
+            if (frames[i] == NO_PAGE) {
+                continue;
+            }
+            PoolPartition *partition = partitionOf(bufferInfo, fileId, startPage + i);
+            if (i >= readable) {
+                memset(pages[i], 0, PAGE_SIZE);
+            }
+            __atomic_store_n(&bufferInfo->frames[frames[i]].fixCount, 0, __ATOMIC_RELAXED);
+            tierDrop(bufferInfo->tier, fileId, startPage + i);
+            countEvent(&partition->readCount);
+            installFrame(bufferInfo, partition, frames[i], fileId, startPage + i, FALSE);
+            endFrameWrite(&bufferInfo->frames[frames[i]].version);
+            releasePin(bufferInfo, partition, frames[i]);
+            countEvent(&partition->prefetchLoads);
         }
     }
 
-    // Write dirty pages to disk
-    RC status = writeDirtyPagesToDisk(bufferPool);
-    if (status != RC_OK) {
-        return status;
+    for (p = bufferInfo->numPartitions - 1; p >= 0; p--) {
+        if (latched[p]) {
+            pthread_mutex_unlock(&bufferInfo->partitions[p].tableLatch);
+        }
     }
+    if (unlatched) {
+        endUnlatchedIo(bufferInfo);
+    }
+}
 
-    // Close the file and release memory
-    status = closePageFile(&bufferInfo->fileHandle);
-    if (status != RC_OK) {
-        return RC_CLOSE_FAILED;
+// Prefetcher thread: take the queued pages in runs of consecutive pages of one file and
+// load those that are not buffered yet, leaving them unpinned
+static void *prefetcher(void *arg) {
+    BufferPoolInfo *bufferInfo = arg;
+    bool *latched = (bool *)calloc(bufferInfo->numPartitions, sizeof(bool));
+
+    pthread_mutex_lock(&bufferInfo->prefetchLatch);
+    while (!bufferInfo->prefetchStop) {
+        if (bufferInfo->prefetchCount == 0 || latched == NULL) {
+            pthread_cond_wait(&bufferInfo->prefetchWake, &bufferInfo->prefetchLatch);
+            continue;
+        }
+        PrefetchRequest request = bufferInfo->prefetchQueue[bufferInfo->prefetchHead];
+        int numPages = 0;
+        while (numPages < PREFETCH_BATCH_PAGES && bufferInfo->prefetchCount > 0 &&
+               bufferInfo->prefetchQueue[bufferInfo->prefetchHead].fileId == request.fileId &&
+               bufferInfo->prefetchQueue[bufferInfo->prefetchHead].pageNum == request.pageNum + numPages) {
+            bufferInfo->prefetchHead = (bufferInfo->prefetchHead + 1) % bufferInfo->maxPages;
+            bufferInfo->prefetchCount--;
+            numPages++;
+        }
+        pthread_mutex_unlock(&bufferInfo->prefetchLatch);
+
+        prefetchRun(bufferInfo, request.fileId, request.pageNum, numPages, latched);
+
+        pthread_mutex_lock(&bufferInfo->prefetchLatch);
     }
+    pthread_mutex_unlock(&bufferInfo->prefetchLatch);
+    free(latched);
+    return NULL;
+}
 
-    releaseBufferMemory(bufferPool);
+static int comparePageNumbers(const void *a, const void *b) {
+    PageNumber left = *(const PageNumber *)a;
+    PageNumber right = *(const PageNumber *)b;
+    return (left > right) - (left < right);
+}
 
-    return RC_OK;
+// Name of a page file's warm restart file, NULL if memory ran out
+static char *warmFileName(BufferPoolInfo *bufferInfo, int fileId) {
+    const char *fileName = bufferInfo->files[fileId].fileName;
+    char *warmName = (char *)malloc(strlen(fileName) + strlen(BM_WARM_SUFFIX) + 1);
+    if (warmName != NULL) {
+        strcpy(warmName, fileName);
+        strcat(warmName, BM_WARM_SUFFIX);
+    }
+    return warmName;
 }
 
+// Write the file's resident pages to its warm restart file, least recently used first.
+// The partitions' replacement orders are merged aligned at their most recent ends. The
+// caller holds the partition latches or has stopped all other users of the pool; the
+// file is only a hint, so failures are ignored
+static void saveWarmPages(BufferPoolInfo *bufferInfo, int fileId) {
+    if (!bufferInfo->warmRestart) {
+        return;
+    }
 
+    PageNumber *pages = (PageNumber *)malloc(bufferInfo->maxPages * sizeof(PageNumber));
+    int *cursors = (int *)malloc(bufferInfo->numPartitions * sizeof(int));
+    int *lengths = (int *)calloc(bufferInfo->numPartitions, sizeof(int));
+    char *warmName = warmFileName(bufferInfo, fileId);
+    int numPages = 0;
+    int longest = 0;
+    int p, f, i;
 
-// Helper function to write dirty pages to disk
-static RC writeDirtyPagesToDisk(BM_BufferPool *const bufferPool) {
-    BufferPoolInfo *bufferInfo = bufferPool->mgmtData;
-    for (int i = 0; i < bufferInfo->maxPages; i++) {
-        if (bufferInfo->dirtyFlags[i]) {
-            int offset = i * PAGE_SIZE;
-            
-            // Ensure the file has sufficient capacity before writing
-            RC status = ensureCapacity(bufferInfo->pageNumbers[i] + 1, &bufferInfo->fileHandle);
-            if (status != RC_OK) {
-                return status;
+    if (pages != NULL && cursors != NULL && lengths != NULL && warmName != NULL) {
+        for (p = 0; p < bufferInfo->numPartitions; p++) {
+            for (f = bufferInfo->partitions[p].orderHead; f != NO_PAGE; f = bufferInfo->frames[f].orderNext) {
+                lengths[p]++;
             }
-
-            // Write the page to disk
-            status = writeBlock(bufferInfo->pageNumbers[i], &bufferInfo->fileHandle, bufferInfo->pageDataBuffer + offset);
-            if (status != RC_OK) {
-                return RC_WRITE_FAILED;
+            longest = lengths[p] > longest ? lengths[p] : longest;
+            cursors[p] = bufferInfo->partitions[p].orderHead;
+        }
+        for (i = 0; i < longest; i++) {
+            for (p = 0; p < bufferInfo->numPartitions; p++) {
+                if (lengths[p] < longest - i) {
+                    continue;
+                }
+                f = cursors[p];
+                cursors[p] = bufferInfo->frames[f].orderNext;
+                if (bufferInfo->frames[f].fileId == fileId) {
+                    pages[numPages++] = bufferInfo->frames[f].pageNumber;
+                }
             }
+        }
 
-            bufferInfo->writeCount++;
+        FILE *warmFile = fopen(warmName, "wb");
+        if (warmFile != NULL) {
+            int header[2] = { WARM_FILE_MAGIC, numPages };
+            fwrite(header, sizeof(header), 1, warmFile);
+            fwrite(pages, sizeof(PageNumber), numPages, warmFile);
+            fclose(warmFile);
         }
     }
-    return RC_OK;
+
+    free(pages);
+    free(cursors);
+    free(lengths);
+    free(warmName);
 }
 
+// Queue the pages of the file's warm restart file for the prefetcher: the most recently
+// used ones that fit in the pool, sorted so the prefetcher reads them in long runs
+static void loadWarmPages(BufferPoolInfo *bufferInfo, int fileId) {
+    if (!bufferInfo->warmRestart) {
+        return;
+    }
 
+    char *warmName = warmFileName(bufferInfo, fileId);
+    FILE *warmFile = warmName != NULL ? fopen(warmName, "rb") : NULL;
+    int header[2];
+    free(warmName);
+    if (warmFile == NULL) {
+        return;
+    }
+    if (fread(header, sizeof(header), 1, warmFile) != 1 || header[0] != WARM_FILE_MAGIC || header[1] <= 0) {
+        fclose(warmFile);
+        return;
+    }
 
-// Helper function to free all allocated buffer memory
-static RC releaseBufferMemory(BM_BufferPool *const bufferPool) {
-    if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
-        return RC_ERROR;
+    int numPages = header[1] < bufferInfo->maxPages ? header[1] : bufferInfo->maxPages;
+    PageNumber *pages = (PageNumber *)malloc(numPages * sizeof(PageNumber));
+    if (pages != NULL && fseek(warmFile, (long)(header[1] - numPages) * sizeof(PageNumber), SEEK_CUR) == 0 &&
+        fread(pages, sizeof(PageNumber), numPages, warmFile) == (size_t)numPages) {
+        qsort(pages, numPages, sizeof(PageNumber), comparePageNumbers);
+        if (queuePrefetch(bufferInfo, fileId, pages, 0, numPages) == RC_OK) {
+            __atomic_add_fetch(&bufferInfo->warmPages, numPages, __ATOMIC_RELAXED);
+        }
     }
+    free(pages);
+    fclose(warmFile);
+}
 
-    BufferPoolInfo *bufferInfo = bufferPool->mgmtData;
 
-    // Free and reset memory allocations
-    if (bufferInfo->accessOrder) {
-        free(bufferInfo->accessOrder);
-        bufferInfo->accessOrder = NULL;
+/*****************************************
+*  Buffer Manager Interface Latched Access
+*****************************************/
+
+// Pin a page and take its frame latch in the given mode
+static RC pinPageLatched(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum, bool exclusive) {
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
     }
-    if (bufferInfo->pageNumbers) {
-        free(bufferInfo->pageNumbers);
-        bufferInfo->pageNumbers = NULL;
+
+    PoolHandle *handle = bm->mgmtData;
+    BufferPoolInfo *bufferInfo = handle->pool;
+    PoolPartition *partition = partitionOf(bufferInfo, handle->fileId, pageNum);
+    pthread_rwlock_t *frameLatch = NULL;
+    pthread_rwlock_t *loadLatch;
+    bool latched = FALSE;
+    int frame;
+
+    tracePage(bufferInfo, handle->fileId, pageNum, TRACE_PIN);
+
+    // The latch moves with the page when the pool is resized, so look it up under the table
+    // latch. A page still being read is waited for by taking its latch below. The version
+    // is part of the descriptor, which a resize renumbers, so a free exclusive latch is
+    // taken and the version made odd right here; optimistic readers retry until the
+    // exclusive latch is released
+    pthread_mutex_lock(&partition->tableLatch);
+    RC status = pinFrame(bufferInfo, partition, handle->fileId, page, pageNum, &frame, &loadLatch);
+    if (status == RC_OK) {
+        frameLatch = bufferInfo->frames[frame].latch;
+        if (exclusive && pthread_rwlock_trywrlock(frameLatch) == 0) {
+            beginFrameWrite(&bufferInfo->frames[frame].version);
+            latched = TRUE;
+        }
     }
-    if (bufferInfo->dirtyFlags) {
-        free(bufferInfo->dirtyFlags);
-        bufferInfo->dirtyFlags = NULL;
+    pthread_mutex_unlock(&partition->tableLatch);
+    if (bufferInfo->adaptive != NULL) {
+        switchPendingStrategy(bufferInfo);
     }
-    if (bufferInfo->pageFixCount) {
-        free(bufferInfo->pageFixCount);
-        bufferInfo->pageFixCount = NULL;
+    if (status != RC_OK) {
+        return status;
     }
-    if (bufferInfo->pageDataBuffer) {
-        free(bufferInfo->pageDataBuffer);
-        bufferInfo->pageDataBuffer = NULL;
+
+    // The pin keeps the frame from being replaced while we wait for its latch
+    // Only a latch held by another thread counts as a pin wait
+    if (exclusive) {
+        if (!latched) {
+            __atomic_add_fetch(&partition->pinWaitCount, 1, __ATOMIC_RELAXED);
+            pthread_rwlock_wrlock(frameLatch);
+            pthread_mutex_lock(&partition->tableLatch);
+            beginFrameWrite(&bufferInfo->frames[lookupFrame(bufferInfo, partition, handle->fileId, pageNum)].version);
+            pthread_mutex_unlock(&partition->tableLatch);
+        }
+    } else if (pthread_rwlock_tryrdlock(frameLatch) != 0) {
+        __atomic_add_fetch(&partition->pinWaitCount, 1, __ATOMIC_RELAXED);
+        pthread_rwlock_rdlock(frameLatch);
     }
+    return RC_OK;
+}
 
-    // Free the BufferPoolInfo structure itself
-    free(bufferInfo);
-    bufferPool->mgmtData = NULL;
+// Pin a page for reading, concurrent readers share the frame
+RC pinPageShared(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
+    return pinPageLatched(bm, page, pageNum, FALSE);
+}
 
-    return RC_OK;
+// Pin a page for writing, excluding every other latched reader and writer
+RC pinPageExclusive(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
+    return pinPageLatched(bm, page, pageNum, TRUE);
 }
 
-// Helper to ensure file size matches required buffer capacity
-static RC ensureFileSize(FILE *file, long requiredSize) {
-    fseek(file, 0, SEEK_END);
-    long currentSize = ftell(file);
-    
-    if (currentSize < requiredSize) {
-        fseek(file, requiredSize - 1, SEEK_SET);
-        fputc('\0', file);
+// Release the frame latch taken by pinPageShared/pinPageExclusive and unpin the page
+RC unpinPageLatched(BM_BufferPool *const bm, BM_PageHandle *const page) {
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
     }
-    return RC_OK;
-}
 
+    PoolHandle *handle = bm->mgmtData;
+    BufferPoolInfo *bufferInfo = handle->pool;
+    PoolPartition *partition = partitionOf(bufferInfo, handle->fileId, page->pageNum);
 
-// Function to force flushing the buffer pool to disk
-RC forceFlushPool(BM_BufferPool *const bufferPool) {
-    if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
+    pthread_rwlock_t *frameLatch = NULL;
+
+    pthread_mutex_lock(&partition->tableLatch);
+    int frame = lookupFrame(bufferInfo, partition, handle->fileId, page->pageNum);
+    if (frame != NO_PAGE) {
+        frameLatch = bufferInfo->frames[frame].latch;
+        // An odd version while we hold the latch means we hold it exclusively
+        if (__atomic_load_n(&bufferInfo->frames[frame].version, __ATOMIC_RELAXED) & 1) {
+            endFrameWrite(&bufferInfo->frames[frame].version);
+        }
+    }
+    pthread_mutex_unlock(&partition->tableLatch);
+    if (frame == NO_PAGE) {
         return RC_ERROR;
     }
 
-    BufferPoolInfo *bufferInfo = bufferPool->mgmtData;
-    RC status = RC_OK;
+    // Still pinned by us, so the page cannot have changed hands in between
+    pthread_rwlock_unlock(frameLatch);
+    return unpinPage(bm, page);
+}
 
-    for (int i = 0; i < bufferInfo->maxPages; i++) {
-        // Flush pages that are dirty and not currently pinned
-        if (bufferInfo->pageFixCount[i] == 0 && bufferInfo->dirtyFlags[i]) {
-            FILE *file = fopen(bufferInfo->fileHandle.fileName, "r+");
-            if (!file) {
-                return RC_WRITE_FAILED;
-            }
 
-            // Ensure the file is large enough for the page
-            long requiredSize = (bufferInfo->pageNumbers[i] + 1) * PAGE_SIZE;
-            ensureFileSize(file, requiredSize);
+/*****************************************
+*  Buffer Manager Interface Optimistic Reads
+*****************************************/
 
-            // Write page data to the file
-            int offset = i * PAGE_SIZE;
-            fseek(file, bufferInfo->pageNumbers[i] * PAGE_SIZE, SEEK_SET);
-            if (fwrite(bufferInfo->pageDataBuffer + offset, sizeof(char), PAGE_SIZE, file) != PAGE_SIZE) {
-                fclose(file);
-                return RC_WRITE_FAILED;
-            }
+// Find or load the frame of a page for an optimistic read, leaving it unpinned
+static RC locateOptimistic(BufferPoolInfo *bufferInfo, int fileId, const PageNumber pageNum, int *frameOut) {
+    PoolPartition *partition = partitionOf(bufferInfo, fileId, pageNum);
+    pthread_rwlock_t *loadLatch;
+    BM_PageHandle page;
+    RC status = RC_OK;
 
-            fclose(file);
-            bufferInfo->dirtyFlags[i] = FALSE;
-            bufferInfo->writeCount++;
+    pthread_mutex_lock(&partition->tableLatch);
+    int frame = lookupFrame(bufferInfo, partition, fileId, pageNum);
+    if (frame == NO_PAGE) {
+        // A page still being read fails the version check, no need to wait for it
+        status = pinFrame(bufferInfo, partition, fileId, &page, pageNum, &frame, &loadLatch);
+        if (status == RC_OK) {
+            releasePin(bufferInfo, partition, frame);
         }
     }
+    pthread_mutex_unlock(&partition->tableLatch);
 
+    *frameOut = frame;
     return status;
 }
 
-
-// Function to update the order of recently used pages
-static void shiftAccessOrder(int startIndex, int endIndex, BufferPoolInfo *bufferInfo, int newPageNumber) {
-    for (int i = startIndex; i < endIndex; i++) {
-        bufferInfo->accessOrder[i] = bufferInfo->accessOrder[i + 1];
+// Count an optimistic reader in the current reader epoch, with the partition of its
+// page; the epoch is checked again after the count, so a resize that advanced it
+// meanwhile either sees the reader or the reader sees the new frames
+static unsigned int enterOptimisticRead(BufferPoolInfo *bufferInfo, PoolPartition *partition) {
+    for (;;) {
+        unsigned int epoch = __atomic_load_n(&bufferInfo->readerEpoch, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&partition->optimisticReaders[epoch & 1], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&bufferInfo->readerEpoch, __ATOMIC_SEQ_CST) == epoch) {
+            return epoch;
+        }
+        leaveOptimisticRead(partition, epoch);
     }
-    bufferInfo->accessOrder[endIndex] = newPageNumber;
 }
 
-// Function to update buffer statistics
-static void updateBufferStats(BufferPoolInfo *bufferInfo, int bufferIndex, int pageNumber) {
-    bufferInfo->pageNumbers[bufferIndex] = pageNumber;
-    bufferInfo->readCount++;
-    bufferInfo->pageFixCount[bufferIndex]++;
-    bufferInfo->dirtyFlags[bufferIndex] = FALSE;
+static void leaveOptimisticRead(PoolPartition *partition, unsigned int epoch) {
+    __atomic_sub_fetch(&partition->optimisticReaders[epoch & 1], 1, __ATOMIC_RELEASE);
 }
 
+// Advance the reader epoch and wait for the readers of the old one, which may still use
+// the frames and chunks a resize replaced; called after the new frames are published
+static void waitForOptimisticReaders(BufferPoolInfo *bufferInfo) {
+    unsigned int epoch = __atomic_fetch_add(&bufferInfo->readerEpoch, 1, __ATOMIC_SEQ_CST);
+    for (int p = 0; p < bufferInfo->numPartitions; p++) {
+        while (__atomic_load_n(&bufferInfo->partitions[p].optimisticReaders[epoch & 1], __ATOMIC_ACQUIRE) != 0) {
+            sched_yield();
+        }
+    }
+}
 
-
-/*****************************************
-*  Buffer Manager Interface Access Pages 
-*****************************************/
-
-// Mark a page as dirty in the buffer pool
-RC markDirty(BM_BufferPool *const bufferPool, BM_PageHandle *const page) {
-    // Check if buffer manager or management data is null
-    if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
+// Copy length bytes at offset of a page into dest without pinning it or taking a latch.
+// The handle remembers the page's frame between calls; the copy is validated against
+// the frame's version and retried if the page was written, replaced or the pool resized
+// meanwhile, falling back to a shared latch after OPTIMISTIC_READ_RETRIES attempts.
+// Writers of pages read this way must use pinPageExclusive. Optimistic reads do not
+// count as uses for LRU, a page only read this way ages out and is loaded again
+RC readPageOptimistic(BM_BufferPool *const bm, BM_OptimisticHandle *optimistic, const PageNumber pageNum,
+                      char *dest, int offset, int length) {
+    if (bm == NULL || bm->mgmtData == NULL) {
         return RC_FILE_HANDLE_NOT_INIT;
     }
+    if (optimistic == NULL || dest == NULL || pageNum < 0 || offset < 0 || length < 0 || offset + length > PAGE_SIZE) {
+        return RC_ERROR;
+    }
 
-    BufferPoolInfo *bufferInfo = bufferPool->mgmtData;
+    PoolHandle *handle = bm->mgmtData;
+    BufferPoolInfo *bufferInfo = handle->pool;
+    PoolPartition *partition = partitionOf(bufferInfo, handle->fileId, pageNum);
+    RC status;
 
-    // Search for the specified page number in the buffer
-    for (int i = 0; i < bufferInfo->maxPages; i++) {
-        if (bufferInfo->pageNumbers[i] == page->pageNum) {
-            // Set the dirty flag to TRUE if not already set
-            if (!bufferInfo->dirtyFlags[i]) {
-                bufferInfo->dirtyFlags[i] = TRUE;
+    for (int attempt = 0; attempt < OPTIMISTIC_READ_RETRIES; attempt++) {
+        unsigned int layout = __atomic_load_n(&bufferInfo->layoutVersion, __ATOMIC_ACQUIRE);
+        if (layout & 1) {
+            continue;
+        }
+
+        // First read of the page, or its frame may have changed: look it up under the latch
+        if (optimistic->frame == NO_PAGE || optimistic->pageNum != pageNum || optimistic->layout != layout) {
+            int frame;
+            status = locateOptimistic(bufferInfo, handle->fileId, pageNum, &frame);
+            if (status != RC_OK) {
+                return status;
             }
-            break; // Exit once the page is marked dirty
+            optimistic->pageNum = pageNum;
+            optimistic->frame = frame;
+            optimistic->layout = layout;
+            continue;
+        }
+
+        // A resize publishes its frames after it made the layout odd, so frames of a later
+        // layout fail the check below; the reader epoch keeps the old ones from being freed
+        unsigned int epoch = enterOptimisticRead(bufferInfo, partition);
+        BM_PageFrame *frames = __atomic_load_n(&bufferInfo->frames, __ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&bufferInfo->layoutVersion, __ATOMIC_ACQUIRE) != layout) {
+            leaveOptimisticRead(partition, epoch);
+            continue;
+        }
+
+        int frame = optimistic->frame;
+        unsigned int *frameVersion = &frames[frame].version;
+        unsigned int version = __atomic_load_n(frameVersion, __ATOMIC_ACQUIRE);
+        bool copied = FALSE;
+        if (!(version & 1)) {
+            if (__atomic_load_n(&frames[frame].pageNumber, __ATOMIC_RELAXED) != pageNum ||
+                __atomic_load_n(&frames[frame].fileId, __ATOMIC_RELAXED) != handle->fileId) {
+                optimistic->frame = NO_PAGE;
+            } else {
+                memcpy(dest, frames[frame].data + offset, length);
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                copied = __atomic_load_n(frameVersion, __ATOMIC_RELAXED) == version &&
+                         __atomic_load_n(&bufferInfo->layoutVersion, __ATOMIC_RELAXED) == layout;
+            }
+        }
+        leaveOptimisticRead(partition, epoch);
+        if (copied) {
+            return RC_OK;
         }
     }
 
-    return RC_OK;
+    // Too much interference: read under a shared latch instead
+    BM_PageHandle page;
+    optimistic->frame = NO_PAGE;
+    __atomic_add_fetch(&partition->optimisticFallbacks, 1, __ATOMIC_RELAXED);
+    status = pinPageShared(bm, &page, pageNum);
+    if (status != RC_OK) {
+        return status;
+    }
+    memcpy(dest, page.data + offset, length);
+    return unpinPageLatched(bm, &page);
 }
 
-// Force a page to be written to disk from the buffer pool
-RC forcePage(BM_BufferPool *const bufferPool, BM_PageHandle *const page) {
-    // Check if buffer manager or management data is null
-    if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
-        return RC_FILE_HANDLE_NOT_INIT;
-    }
 
-    BufferPoolInfo *bufferInfo = bufferPool->mgmtData;
-    bool pageFound = FALSE;
+/*****************************************
+*  Buffer Manager Interface Tracing
+*****************************************/
 
-    // Search for the specified page in the buffer pool
-    for (int i = 0; i < bufferInfo->maxPages; i++) {
-        if (bufferInfo->pageNumbers[i] == page->pageNum) {
-            int offset = i * PAGE_SIZE;
-            printf("Simulated writing of page %d to disk at offset %d.\n", page->pageNum, offset);
+// Append the buffered trace records to the trace file, the caller holds the trace latch
+static void flushTrace(BufferPoolInfo *bufferInfo) {
+    if (bufferInfo->traceCount > 0 &&
+        fwrite(bufferInfo->traceBuffer, sizeof(BM_TraceRecord), bufferInfo->traceCount, bufferInfo->traceFile) !=
+            (size_t)bufferInfo->traceCount) {
+        bufferInfo->traceFailed = TRUE;
+    }
+    bufferInfo->traceCount = 0;
+}
 
-            // Mark the page as clean and increment the write count
-            bufferInfo->dirtyFlags[i] = FALSE;
-            bufferInfo->writeCount++;
+// Record a pin or unpin if the pool is being traced
+static void tracePage(BufferPoolInfo *bufferInfo, int fileId, PageNumber pageNum, BM_TraceOp op) {
+    if (!__atomic_load_n(&bufferInfo->tracing, __ATOMIC_RELAXED)) {
+        return;
+    }
 
-            pageFound = TRUE;
-            break;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    pthread_mutex_lock(&bufferInfo->traceLatch);
+    if (bufferInfo->traceFile != NULL) {
+        BM_TraceRecord *record = &bufferInfo->traceBuffer[bufferInfo->traceCount++];
+        record->timestamp = (now.tv_sec - bufferInfo->traceStart.tv_sec) * 1000000000LL +
+                            (now.tv_nsec - bufferInfo->traceStart.tv_nsec);
+        record->pageNum = pageNum;
+        record->fileId = (short)fileId;
+        record->op = (char)op;
+        record->reserved = 0;
+        if (bufferInfo->traceCount == TRACE_BUFFER_RECORDS) {
+            flushTrace(bufferInfo);
         }
     }
-
-    // Return success if the page was found and written, otherwise return failure
-    return pageFound ? RC_OK : RC_WRITE_FAILED;
+    pthread_mutex_unlock(&bufferInfo->traceLatch);
 }
 
+// Write out the remaining records and close the trace file, if any
+static RC closeTrace(BufferPoolInfo *bufferInfo) {
+    RC status = RC_OK;
 
-// Unpin a page in the buffer pool
-RC unpinPage(BM_BufferPool *const bufferPool, BM_PageHandle *const page) {
-    // Check if buffer manager or management data is null
-    if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
+    pthread_mutex_lock(&bufferInfo->traceLatch);
+    if (bufferInfo->traceFile != NULL) {
+        __atomic_store_n(&bufferInfo->tracing, FALSE, __ATOMIC_RELAXED);
+        flushTrace(bufferInfo);
+        if (fclose(bufferInfo->traceFile) != 0 || bufferInfo->traceFailed) {
+            status = RC_WRITE_FAILED;
+        }
+        bufferInfo->traceFile = NULL;
+        free(bufferInfo->traceBuffer);
+        bufferInfo->traceBuffer = NULL;
+    }
+    pthread_mutex_unlock(&bufferInfo->traceLatch);
+    return status;
+}
+
+// Start recording every pin and unpin of the pool (all files of a shared pool) to a
+// binary trace file: a BM_TraceHeader followed by BM_TraceRecords; bm_sim replays it
+RC startPoolTrace(BM_BufferPool *const bm, const char *traceFileName) {
+    if (bm == NULL || bm->mgmtData == NULL) {
         return RC_FILE_HANDLE_NOT_INIT;
     }
+    if (traceFileName == NULL) {
+        return RC_ERROR;
+    }
 
-    BufferPoolInfo *bufferInfo = bufferPool->mgmtData;
+    BufferPoolInfo *bufferInfo = ((PoolHandle *)bm->mgmtData)->pool;
+    RC status = RC_OK;
 
-    // Search for the specified page in the buffer pool
-    for (int i = 0; i < bufferInfo->maxPages; i++) {
-        if (bufferInfo->pageNumbers[i] == page->pageNum) {
-            // Decrease the fix count if it is greater than 0
-            if (bufferInfo->pageFixCount[i] > 0) {
-                bufferInfo->pageFixCount[i]--;
-            }
-            return RC_OK; // Page found and unpinned successfully
-        }
+    pthread_mutex_lock(&bufferInfo->traceLatch);
+    if (bufferInfo->traceFile != NULL) {
+        pthread_mutex_unlock(&bufferInfo->traceLatch);
+        return RC_ERROR;
     }
 
-    // If the page wasn't found in the buffer, return OK (consistent behavior)
+    BM_TraceHeader header = { BM_TRACE_MAGIC, BM_TRACE_VERSION, bufferInfo->maxPages, bufferInfo->strategyType };
+    bufferInfo->traceBuffer = (BM_TraceRecord *)malloc(TRACE_BUFFER_RECORDS * sizeof(BM_TraceRecord));
+    bufferInfo->traceFile = bufferInfo->traceBuffer ? fopen(traceFileName, "wb") : NULL;
+    if (bufferInfo->traceFile == NULL) {
+        status = bufferInfo->traceBuffer ? RC_FILE_NOT_FOUND : RC_MEMORY_ALLOCATION_FAIL;
+    } else if (fwrite(&header, sizeof(BM_TraceHeader), 1, bufferInfo->traceFile) != 1) {
+        fclose(bufferInfo->traceFile);
+        bufferInfo->traceFile = NULL;
+        status = RC_WRITE_FAILED;
+    }
+    if (status != RC_OK) {
+        free(bufferInfo->traceBuffer);
+        bufferInfo->traceBuffer = NULL;
+        pthread_mutex_unlock(&bufferInfo->traceLatch);
+        return status;
+    }
+
+    bufferInfo->traceCount = 0;
+    bufferInfo->traceFailed = FALSE;
+    clock_gettime(CLOCK_MONOTONIC, &bufferInfo->traceStart);
+    __atomic_store_n(&bufferInfo->tracing, TRUE, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&bufferInfo->traceLatch);
     return RC_OK;
 }
 
-
-// Pin a page in the buffer pool
-RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum){
-    BufferPoolInfo *buffer_pool;
-    bool void_page=FALSE;
-    bool foundedPage=FALSE;
-    bool UpdatedStra_found=FALSE;
-    int read_code;
-    int record_pointer;
-    int memory_address;
-    int swap_location;
-    
-    SM_PageHandle page_handle;
-    buffer_pool=bm->mgmtData;
-    buffer_pool = bm->mgmtData;
-    
-    void_page = (buffer_pool->availableSlots == buffer_pool->maxPages) ? TRUE : void_page;
-    if (!void_page) {
-    int totalPages = buffer_pool->maxPages - buffer_pool->availableSlots;
-    for (int i = 0; i < totalPages; i++) {
-
-        if (buffer_pool->pageNumbers[i] == pageNum) {
-            page->pageNum = pageNum;
-            int memory_address = i;
-            buffer_pool->pageFixCount[memory_address]++;
-            page->data = &buffer_pool->pageDataBuffer[memory_address * PAGE_SIZE];
-            foundedPage = TRUE;
-            if (buffer_pool->strategyType == RS_LRU) {
-                    int lastPosition = buffer_pool->maxPages - buffer_pool->availableSlots - 1; 
-                    swap_location = -1; 
-                    for (int j = 0; j <= lastPosition; j++) 
-                        if (buffer_pool->accessOrder[j] != pageNum) {
-                            if (j == buffer_pool->maxPages - 1) {
-                                swap_location = -1;
-                            }
-                            } else {
-                            swap_location = j;
-                            break;
-                        }
-                        if (swap_location != -1) {
-                            memmove(&buffer_pool->accessOrder[swap_location], &buffer_pool->accessOrder[swap_location + 1], (lastPosition - swap_location) * sizeof(buffer_pool->accessOrder[0]));
-                            buffer_pool->accessOrder[lastPosition] = pageNum;
-                        }
-                }
-                            else {
-                                int unutilized = 0;
-                                do {
-                                    //printf("This loop executes exactly once.\n");
-                                } while (++unutilized < 1);
-                        }
-            return RC_OK;
-        }
-        }
-    } 
-
-    if ((void_page == TRUE && buffer_pool != NULL && (1 == 1)) || 
-    ((foundedPage != TRUE && foundedPage == FALSE) && buffer_pool->availableSlots > 0 && 
-    buffer_pool->availableSlots <= buffer_pool->maxPages && buffer_pool->availableSlots == buffer_pool->availableSlots && 
-    (buffer_pool->availableSlots != -1 && buffer_pool->maxPages != -1) && 
-    (buffer_pool->availableSlots >= 0 && buffer_pool->maxPages >= buffer_pool->availableSlots) && 
-    ((buffer_pool->availableSlots + 1) > 1) && ((buffer_pool->maxPages - buffer_pool->availableSlots) >= 0)))
-    {
-        page_handle = (SM_PageHandle)calloc(1, PAGE_SIZE);
-        if (page_handle != NULL) {
-
-            read_code = readBlock(pageNum, &buffer_pool->fileHandle, page_handle);
-            if (read_code >= 0) {
-                size_t total_used_pages = buffer_pool->maxPages - buffer_pool->availableSlots;
-                memory_address = total_used_pages;
-                if (memory_address >= 0 && memory_address <= buffer_pool->maxPages) {
-                    size_t base_address = 0; 
-                    record_pointer = (memory_address * PAGE_SIZE) + base_address;
-
-                } 
-            } 
-        }
-        
-        memcpy(buffer_pool->pageDataBuffer + record_pointer, page_handle, PAGE_SIZE);
-        buffer_pool->availableSlots--;
-        buffer_pool->accessOrder[memory_address] = pageNum;
-        buffer_pool->pageNumbers[memory_address] = pageNum;
-        buffer_pool->readCount++;
-        buffer_pool->pageFixCount[memory_address]++;
-        buffer_pool->dirtyFlags[memory_address] = FALSE;
-        page->pageNum = pageNum;
-        page->data = &(buffer_pool->pageDataBuffer[record_pointer]);
-        free(page_handle);
-
-        return RC_OK;
+// Stop tracing and close the trace file; shutting the pool down does the same
+RC stopPoolTrace(BM_BufferPool *const bm) {
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
     }
-       
-        bool isPageNotFound = !foundedPage;
-        bool isBufferPoolValid = buffer_pool != NULL;
-        bool isBufferPoolFull = buffer_pool->availableSlots == 0;
-
-        if (isPageNotFound && isBufferPoolValid && isBufferPoolFull)
-        {
-        UpdatedStra_found = FALSE;
-        page_handle = (SM_PageHandle) malloc(PAGE_SIZE);
-        if (page_handle != NULL) {
-            memset(page_handle, 0, PAGE_SIZE);
-        }
-        read_code = readBlock(pageNum, &buffer_pool->fileHandle, page_handle);
-
-
-        if (buffer_pool->strategyType == RS_FIFO || buffer_pool->strategyType == RS_LRU) {
-            int i = 0, j = 0;
-            do {
-                int swap_page = buffer_pool->accessOrder[j];
-                i = 0; 
-                do {
-                    if (buffer_pool->pageNumbers[i] == swap_page && buffer_pool->pageFixCount[i] == 0) {
-                        memory_address = i;
-                        record_pointer = i * PAGE_SIZE;
-                        if (buffer_pool->dirtyFlags[i]) {
-                            read_code = ensureCapacity(buffer_pool->pageNumbers[i] + 1, &buffer_pool->fileHandle);
-                            read_code = writeBlock(buffer_pool->pageNumbers[i], &buffer_pool->fileHandle, buffer_pool->pageDataBuffer + record_pointer);
-                            buffer_pool->writeCount++;
-                        }
-                        swap_location = j;
-                        UpdatedStra_found = TRUE;
-                        break; 
-                    }
-                    i++;
-                } while (i < buffer_pool->maxPages && !UpdatedStra_found);
-                j++;
-                if (UpdatedStra_found) break; 
-            } while (j < buffer_pool->maxPages);
-        }
-    }
-
-
-    if (UpdatedStra_found == FALSE) {
-        free(page_handle);
-        return RC_BUFFERPOOL_FULL;
-    } 
-        
-    record_pointer = memory_address * PAGE_SIZE;
-    int i = 0;
-    if (i < PAGE_SIZE) {
-        do {
-            buffer_pool->pageDataBuffer[i + record_pointer] = page_handle[i];
-            i++;
-        } while (i < PAGE_SIZE);
-    }
-            
-    // primary logic
-    if (buffer_pool->strategyType == RS_LRU || buffer_pool->strategyType == RS_FIFO) {
-        shiftAccessOrder(swap_location, buffer_pool->maxPages - 1, buffer_pool, pageNum);
-    } 
-    updateBufferStats(buffer_pool, memory_address, pageNum);
-    page->pageNum = pageNum;
-    page->data = buffer_pool->pageDataBuffer + record_pointer;
-    free(page_handle); 
-    return RC_OK; 
+    return closeTrace(((PoolHandle *)bm->mgmtData)->pool);
 }
 
 
 /******************************
-*  Statistics Interface      
+*  Statistics Interface
 ******************************/
 
+// Check whether no partition has loaded a page yet
+static bool isPoolEmpty(BufferPoolInfo *bufferInfo) {
+    for (int p = 0; p < bufferInfo->numPartitions; p++) {
+        if (bufferInfo->partitions[p].availableSlots != bufferInfo->partitions[p].numFrames) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+// One of the handle's views, sized for the current pool
+static void *frameView(PoolHandle *handle, void **view, size_t elementSize) {
+    BufferPoolInfo *bufferInfo = handle->pool;
+
+    // The pool was resized since the views were made
+    if (handle->viewPages != bufferInfo->maxPages) {
+        free(handle->frameContentsView);
+        free(handle->dirtyFlagsView);
+        free(handle->fixCountsView);
+        handle->frameContentsView = NULL;
+        handle->dirtyFlagsView = NULL;
+        handle->fixCountsView = NULL;
+        handle->viewPages = bufferInfo->maxPages;
+    }
+    if (*view == NULL) {
+        *view = malloc(bufferInfo->maxPages * elementSize);
+    }
+    return *view;
+}
+
+// Whether a frame belongs in the handle's views, frames holding other files' pages of
+// a shared pool show up as empty
+static inline bool inView(PoolHandle *handle, int frame) {
+    BufferPoolInfo *bufferInfo = handle->pool;
+    return !bufferInfo->shared || __atomic_load_n(&bufferInfo->frames[frame].fileId, __ATOMIC_RELAXED) == handle->fileId;
+}
+
 // Define the page numbers as an array
 PageNumber *getFrameContents(BM_BufferPool *const bufferPool)
 {
     // Access the buffer pool management data
-    BufferPoolInfo *bufferInfo = bufferPool->mgmtData;
+    PoolHandle *handle = bufferPool->mgmtData;
+    BufferPoolInfo *bufferInfo = handle->pool;
+    PageNumber *contents = NULL;
+    int p;
 
-    // Check if the buffer pool is entirely empty
-    if (bufferInfo->availableSlots == bufferInfo->maxPages) {
-        return NULL; // Return NULL if no pages are currently loaded
+    // The partition latches keep a resize from replacing the frames during the copy
+    for (p = 0; p < bufferInfo->numPartitions; p++) {
+        pthread_mutex_lock(&bufferInfo->partitions[p].tableLatch);
     }
 
-    // Return the array of page numbers currently in the buffer frames
-    return bufferInfo->pageNumbers;
+    // Collect the page numbers currently in the buffer frames, NULL if no pages are loaded
+    if (!isPoolEmpty(bufferInfo)) {
+        contents = frameView(handle, (void **)&handle->frameContentsView, sizeof(PageNumber));
+    }
+    for (int i = 0; contents != NULL && i < bufferInfo->maxPages; i++) {
+        contents[i] = inView(handle, i) ? __atomic_load_n(&bufferInfo->frames[i].pageNumber, __ATOMIC_RELAXED) : NO_PAGE;
+    }
+    for (p = bufferInfo->numPartitions - 1; p >= 0; p--) {
+        pthread_mutex_unlock(&bufferInfo->partitions[p].tableLatch);
+    }
+    return contents;
 }
 
 // Retrieve an array of dirty page flags for each frame
@@ -523,53 +4212,156 @@ bool *getDirtyFlags(BM_BufferPool *const bufferPool) {
         return NULL;
     }
 
-    BufferPoolInfo *bufferData = bufferPool->mgmtData;
-    return bufferData->dirtyFlags;
+    PoolHandle *handle = bufferPool->mgmtData;
+    BufferPoolInfo *bufferInfo = handle->pool;
+    int p;
+
+    for (p = 0; p < bufferInfo->numPartitions; p++) {
+        pthread_mutex_lock(&bufferInfo->partitions[p].tableLatch);
+    }
+    bool *dirtyFlags = frameView(handle, (void **)&handle->dirtyFlagsView, sizeof(bool));
+    for (int i = 0; dirtyFlags != NULL && i < bufferInfo->maxPages; i++) {
+        dirtyFlags[i] = inView(handle, i) ? __atomic_load_n(&bufferInfo->frames[i].isDirty, __ATOMIC_RELAXED) : FALSE;
+    }
+    for (p = bufferInfo->numPartitions - 1; p >= 0; p--) {
+        pthread_mutex_unlock(&bufferInfo->partitions[p].tableLatch);
+    }
+    return dirtyFlags;
 }
 
-// Retrieve the number of pages that have been read
+// Retrieve the number of pages that have been read (by the whole pool)
 int getNumReadIO(BM_BufferPool *const bufferPool) {
     // Check if the buffer manager or management data is null
     if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
         return 0;
     }
 
-    // Access the number of reads from the buffer pool management data
-    BufferPoolInfo *bufferInfo = bufferPool->mgmtData;
-    return bufferInfo->readCount;
+    // Sum the number of reads over all partitions
+    BufferPoolInfo *bufferInfo = ((PoolHandle *)bufferPool->mgmtData)->pool;
+    long long readCount = 0;
+    for (int p = 0; p < bufferInfo->numPartitions; p++) {
+        readCount += __atomic_load_n(&bufferInfo->partitions[p].readCount, __ATOMIC_RELAXED);
+    }
+    return (int)readCount;
 }
 
-// Retrieve the number of pages that have been written to disk
+// Retrieve the number of pages that have been written to disk (by the whole pool)
 int getNumWriteIO(BM_BufferPool *const bufferPool) {
     // Check if the buffer manager or management data is null
     if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
         return 0;
     }
 
-    // Access the number of writes from the buffer pool management data
-    BufferPoolInfo *bufferInfo = bufferPool->mgmtData;
-    return bufferInfo->writeCount;
+    // Sum the number of writes over all partitions
+    BufferPoolInfo *bufferInfo = ((PoolHandle *)bufferPool->mgmtData)->pool;
+    long long writeCount = 0;
+    for (int p = 0; p < bufferInfo->numPartitions; p++) {
+        writeCount += __atomic_load_n(&bufferInfo->partitions[p].writeCount, __ATOMIC_RELAXED);
+    }
+    return (int)writeCount;
 }
 
 // Retrieve the fix counts for each page in the buffer pool
 int *getFixCounts(BM_BufferPool *const bufferPool) {
     // Validate the buffer manager and management data
     if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
-        printf("Buffer pool or management data is missing.\n");
         return NULL;
     }
 
-    BufferPoolInfo *bufferInfo = bufferPool->mgmtData;
+    PoolHandle *handle = bufferPool->mgmtData;
+    BufferPoolInfo *bufferInfo = handle->pool;
+    static int noFixes = 0;
+    int *fixCounts = &noFixes;
+    int p;
+
+    for (p = 0; p < bufferInfo->numPartitions; p++) {
+        pthread_mutex_lock(&bufferInfo->partitions[p].tableLatch);
+    }
+
+    // Collect the fix counts for pages in the buffer, unless no pages are loaded (all
+    // slots are available)
+    if (!isPoolEmpty(bufferInfo)) {
+        fixCounts = frameView(handle, (void **)&handle->fixCountsView, sizeof(int));
+        for (int i = 0; fixCounts != NULL && i < bufferInfo->maxPages; i++) {
+            fixCounts[i] = inView(handle, i) ? fixCountOf(bufferInfo, i) : 0;
+        }
+    }
+    for (p = bufferInfo->numPartitions - 1; p >= 0; p--) {
+        pthread_mutex_unlock(&bufferInfo->partitions[p].tableLatch);
+    }
+    return fixCounts;
+}
 
-    // Check if no pages are currently pinned (all slots are available)
-    if (bufferInfo->availableSlots == bufferInfo->maxPages) {
-        static int noFixes = 0;
-        printf("No pages are currently pinned in the buffer.\n");
-        return &noFixes;
+// Retrieve the number of forcePage calls on the pool
+int getNumForcedPages(BM_BufferPool *const bufferPool) {
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
+        return 0;
     }
+    BufferPoolInfo *bufferInfo = ((PoolHandle *)bufferPool->mgmtData)->pool;
+    return (int)__atomic_load_n(&bufferInfo->forceCount, __ATOMIC_RELAXED);
+}
 
-    // Return the array of fix counts for pages in the buffer
-    printf("Returning fix counts for pages currently in use.\n");
-    return bufferInfo->pageFixCount;
+// Retrieve the time spent in forcePage (write plus sync) in nanoseconds, in total or for the slowest call
+long long getForceLatencyNanos(BM_BufferPool *const bufferPool, bool slowest) {
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
+        return 0;
+    }
+    BufferPoolInfo *bufferInfo = ((PoolHandle *)bufferPool->mgmtData)->pool;
+    return __atomic_load_n(slowest ? &bufferInfo->forceNanosMax : &bufferInfo->forceNanosTotal, __ATOMIC_RELAXED);
 }
 
+// Snapshot of the pool's counters, summed over the partitions; for an attached handle
+// they cover every file of the shared pool. Counters still being bumped by other
+// threads may be off by the operations in flight
+BM_PoolStats getPoolStats(BM_BufferPool *const bufferPool) {
+    BM_PoolStats stats;
+    memset(&stats, 0, sizeof(BM_PoolStats));
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL) {
+        return stats;
+    }
+
+    BufferPoolInfo *bufferInfo = ((PoolHandle *)bufferPool->mgmtData)->pool;
+    stats.strategy = __atomic_load_n(&bufferInfo->strategyType, __ATOMIC_RELAXED);
+    stats.numFrames = bufferInfo->maxPages;
+    for (int p = 0; p < bufferInfo->numPartitions; p++) {
+        PoolPartition *partition = &bufferInfo->partitions[p];
+        stats.hits += __atomic_load_n(&partition->hitCount, __ATOMIC_RELAXED);
+        stats.misses += __atomic_load_n(&partition->missCount, __ATOMIC_RELAXED);
+        stats.pinFailures += __atomic_load_n(&partition->pinFailures, __ATOMIC_RELAXED);
+        stats.blockedPins += __atomic_load_n(&partition->blockedPins, __ATOMIC_RELAXED);
+        stats.blockedNanos += __atomic_load_n(&partition->blockedNanos, __ATOMIC_RELAXED);
+        stats.pinTimeouts += __atomic_load_n(&partition->pinTimeouts, __ATOMIC_RELAXED);
+        stats.evictions += __atomic_load_n(&partition->evictionCount, __ATOMIC_RELAXED);
+        stats.dirtyEvictions += __atomic_load_n(&partition->dirtyEvictionCount, __ATOMIC_RELAXED);
+        stats.flushes += __atomic_load_n(&partition->flushCount, __ATOMIC_RELAXED);
+        stats.pinWaits += __atomic_load_n(&partition->pinWaitCount, __ATOMIC_RELAXED);
+        stats.reads += __atomic_load_n(&partition->readCount, __ATOMIC_RELAXED);
+        stats.writes += __atomic_load_n(&partition->writeCount, __ATOMIC_RELAXED);
+        stats.lruPromotions += __atomic_load_n(&partition->lruPromotions, __ATOMIC_RELAXED);
+        stats.pinnedSkips += __atomic_load_n(&partition->pinnedSkips, __ATOMIC_RELAXED);
+        stats.ringRecycles += __atomic_load_n(&partition->ringRecycles, __ATOMIC_RELAXED);
+        stats.prefetchLoads += __atomic_load_n(&partition->prefetchLoads, __ATOMIC_RELAXED);
+        stats.optimisticFallbacks += __atomic_load_n(&partition->optimisticFallbacks, __ATOMIC_RELAXED);
+        stats.admissionRejects += __atomic_load_n(&partition->admissionRejects, __ATOMIC_RELAXED);
+        stats.victimBatches += __atomic_load_n(&partition->victimBatches, __ATOMIC_RELAXED);
+        for (int c = 0; c < BM_NUM_PAGE_CLASSES; c++) {
+            stats.classFrames[c] += __atomic_load_n(&partition->classFrames[c], __ATOMIC_RELAXED);
+        }
+    }
+    stats.forces = __atomic_load_n(&bufferInfo->forceCount, __ATOMIC_RELAXED);
+    stats.warmPages = __atomic_load_n(&bufferInfo->warmPages, __ATOMIC_RELAXED);
+    stats.arenaBacking = __atomic_load_n(&bufferInfo->arenaBacking, __ATOMIC_RELAXED);
+    stats.arenaBytes = __atomic_load_n(&bufferInfo->arenaBytes, __ATOMIC_RELAXED);
+    if (bufferInfo->tier != NULL) {
+        pthread_mutex_lock(&bufferInfo->tier->latch);
+        stats.tierHits = bufferInfo->tier->hits;
+        stats.tierStores = bufferInfo->tier->stores;
+        stats.tierPages = bufferInfo->tier->pages;
+        stats.tierBytes = bufferInfo->tier->bytes;
+        pthread_mutex_unlock(&bufferInfo->tier->latch);
+    }
+    if (bufferInfo->adaptive != NULL) {
+        stats.policySwitches = __atomic_load_n(&bufferInfo->adaptive->switches, __ATOMIC_RELAXED);
+    }
+    return stats;
+}
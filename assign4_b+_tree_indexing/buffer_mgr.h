@@ -1,6 +1,8 @@
 #ifndef BUFFER_MANAGER_H
 #define BUFFER_MANAGER_H
 
+#include <pthread.h>
+
 // Include return codes and methods for logging errors
 #include "dberror.h"
 #include "storage_mgr.h"
@@ -27,27 +29,56 @@ typedef struct BM_PageHandle {
     char *data;
 } BM_PageHandle;
 
-// the page: data + metadata
+// class a caller tags a pinned page with (setPageClass); loaded pages start out as
+// BM_PAGE_DATA. Built-in policies evict the classes in this order, lowest first
+typedef enum BM_PageClass {
+    BM_PAGE_DATA = 0,
+    BM_PAGE_INDEX_LEAF = 1,
+    BM_PAGE_INDEX_INNER = 2,
+    BM_PAGE_HEADER = 3
+} BM_PageClass;
+
+#define BM_NUM_PAGE_CLASSES 4
+
+// descriptor of one frame, the pool keeps them in a single array aligned to cache
+// lines so a pin touches one line of metadata; data and latch point into the frame's
+// chunk and stay put when resizeBufferPool renumbers the frames, the version moves
+// with the descriptor (a pthread_rwlock_t does not fit into the line next to it)
 typedef struct BM_PageFrame {
-    // the data read from disk
-    SM_PageHandle data;
     // the page number in disk file of the current page frame in memory
     PageNumber pageNumber;
-    // is the page content modified
-    bool isDirty;
+    // file of the page within a shared pool, NO_PAGE while the frame is empty
+    int fileId;
     // client count that are using the page currently
     int fixCount;
-    // count that have used the page
-    int usedCount;
-    // logic timestamp that the page is used recently
-    int lastOperationLogicTimestamp;
-    // logic timestamp that the page is loaded to memory
-    int loadToMemoryLogicTimestamp;
-} BM_PageFrame;
+    // next frame in the page's hash chain, and neighbours in the replacement order
+    int hashNext;
+    int orderPrev;
+    int orderNext;
+    // chunk the frame's slot belongs to
+    int chunk;
+    // even while the frame is stable, odd while its page is being replaced or written
+    unsigned int version;
+    // is the page content modified
+    bool isDirty;
+    // BM_PageClass of the page
+    short pageClass;
+    // CLOCK: hit since the hand last passed the frame; LRU-K: hit since it was loaded
+    bool referenced;
+    // the page is being read in without the partition latch; the loader holds the frame
+    // latch in write mode, and pins that find the page wait for it
+    bool loading;
+    // the data read from disk
+    char *data;
+    pthread_rwlock_t *latch;
+} __attribute__((aligned(64))) BM_PageFrame;
+
+_Static_assert(sizeof(BM_PageFrame) == 64, "frame descriptors must fill one cache line");
 
 typedef struct BM_BufferPool {
     char *pageFile;
     int numPages;
+    // the pool's current strategy; adaptivePolicy updates it in every attached handle
     ReplacementStrategy strategy;
     void *mgmtData; // use this one to store the bookkeeping info your buffer
     // manager needs for a buffer pool
@@ -57,6 +88,195 @@ typedef struct BM_BufferPool {
     int numWrites;
 } BM_BufferPool;
 
+// optional pool settings for initBufferPoolWithOptions, zeroed fields keep the defaults
+typedef struct BM_PoolOptions {
+    // number of independently latched partitions the frames are split into (default 1)
+    int numPartitions;
+    // percentage of dirty frames that wakes the background writer (0: no writer)
+    int dirtyHighPercent;
+    // percentage of dirty frames the writer flushes down to (default half the high one)
+    int dirtyLowPercent;
+    // nonzero: forcePage waits until the page is on stable storage (fdatasync)
+    int syncOnForce;
+    // milliseconds a pin that finds every frame of its partition pinned waits for an
+    // unpin before it fails with RC_BUFFERPOOL_FULL (0: fail right away)
+    int pinTimeoutMillis;
+    // nonzero: when a page file is closed its resident pages are listed in a file next
+    // to it (page file name + BM_WARM_SUFFIX); opening it again prefetches those pages
+    int warmRestart;
+    // nonzero: a missed page only displaces the policy's victim if a frequency sketch of
+    // recent pins saw it more often; otherwise it is loaded cold in place of the last
+    // loaded page that has not been hit since (TinyLFU admission)
+    int admissionFilter;
+    // share of a partition's frames, in percent, up to which pages of a class above
+    // BM_PAGE_DATA are only evicted after the lower classes (default 50, 100: no limit)
+    int protectedPercent;
+    // bytes of memory for a second-level cache of evicted pages, kept compressed; misses
+    // look there before reading the page file (0: no such cache)
+    int victimTierBytes;
+    // nonzero: simulate FIFO, LRU, CLOCK and LRU-K on a sample of the pinned pages and
+    // switch the pool to the strategy that would have hit most (built-in policies only)
+    int adaptivePolicy;
+    // victims a miss on a full partition evicts at once, up to BM_MAX_EVICTION_BATCH:
+    // the dirty ones are written back as sorted runs, and all but the one the miss
+    // takes wait on the free list for the next misses (0 or 1: one at a time; ignored
+    // with admissionFilter, which judges every miss against its own victim)
+    int evictionBatch;
+} BM_PoolOptions;
+
+// largest evictionBatch a pool uses
+#define BM_MAX_EVICTION_BATCH 64
+
+// name suffix of the warm restart file of a page file
+#define BM_WARM_SUFFIX ".warm"
+
+// replacement policy passed as stratData to initBufferPool; it replaces the built-in
+// policy of the strategy. The pool copies the struct, state stays owned by the caller.
+// Callbacks run under the latch of the frame's partition, so callbacks for different
+// partitions may run concurrently; NULL callbacks are skipped
+typedef struct BM_ReplacementPolicy {
+    // private state handed to every callback
+    void *state;
+    // the pool now has numFrames frames, numbered 0..numFrames-1; called at creation
+    // and by resizeBufferPool, which renumbers the frames (evicting, then reloading them)
+    void (*onResize) (void *state, int numFrames);
+    // a page was read into frame; cold pages (scan rings) should be replaced early
+    void (*onLoad) (void *state, int frame, bool cold);
+    // the page in frame was pinned again while buffered
+    void (*onHit) (void *state, int frame);
+    // the page in frame was unpinned once
+    void (*onUnpin) (void *state, int frame);
+    // the page in frame leaves the pool
+    void (*onEvict) (void *state, int frame);
+    // an unpinned frame (frames[i].fixCount == 0) of [firstFrame, firstFrame + numFrames)
+    // to replace, all of them hold pages; NO_PAGE if none should be replaced
+    int (*chooseVictim) (void *state, int firstFrame, int numFrames, const BM_PageFrame *frames);
+} BM_ReplacementPolicy;
+
+// size of the process-wide pool when initSharedBufferPool gets no configuration
+#define SHARED_POOL_DEFAULT_PAGES 256
+
+// configuration of the process-wide pool shared by all tables and indexes
+typedef struct BM_SharedPoolConfig {
+    int numPages;
+    ReplacementStrategy strategy;
+    BM_PoolOptions options;
+    // replaces the strategy's built-in policy if set
+    const BM_ReplacementPolicy *policy;
+} BM_SharedPoolConfig;
+
+// private ring of frames a large scan recycles instead of cycling the whole pool
+typedef struct BM_AccessRing {
+    int numFrames;
+    int current;
+    // frames owned by the ring and the page each was loaded with, NO_PAGE while unused
+    int *frames;
+    PageNumber *pageNums;
+} BM_AccessRing;
+
+// pin/unpin trace written by startPoolTrace: a header, then one record per call
+#define BM_TRACE_MAGIC 0x52544d42
+#define BM_TRACE_VERSION 1
+
+typedef enum BM_TraceOp {
+    TRACE_PIN = 0,
+    TRACE_UNPIN = 1
+} BM_TraceOp;
+
+typedef struct BM_TraceHeader {
+    int magic;
+    int version;
+    // size and strategy of the traced pool
+    int numPages;
+    int strategy;
+} BM_TraceHeader;
+
+typedef struct BM_TraceRecord {
+    // nanoseconds since the trace started
+    long long timestamp;
+    PageNumber pageNum;
+    // file of the page within a shared pool, 0 for a private pool
+    short fileId;
+    char op;
+    char reserved;
+} BM_TraceRecord;
+
+// memory behind the page data of the pool's frames, from weakest to strongest: the
+// heap (small pools, or if mmap fails), anonymous 4 KB pages, pages the kernel was asked
+// to back with transparent huge pages (MADV_HUGEPAGE), reserved huge pages (MAP_HUGETLB)
+typedef enum BM_ArenaBacking {
+    ARENA_HEAP = 0,
+    ARENA_PAGES = 1,
+    ARENA_THP = 2,
+    ARENA_HUGETLB = 3
+} BM_ArenaBacking;
+
+// counters returned by getPoolStats; the hit ratio is hits / (hits + misses)
+typedef struct BM_PoolStats {
+    // strategy the pool replaces pages with now, and how often adaptivePolicy changed it
+    ReplacementStrategy strategy;
+    long long policySwitches;
+    int numFrames;
+    // pins that found their page buffered, and those that had to load it
+    long long hits;
+    long long misses;
+    // misses that found every frame of the partition pinned (RC_BUFFERPOOL_FULL) or
+    // could not write their dirty victim back (RC_WRITE_FAILED)
+    long long pinFailures;
+    // pins that waited for an unpin because of pinTimeoutMillis, how long they waited
+    // in total, and how many of them still failed
+    long long blockedPins;
+    long long blockedNanos;
+    long long pinTimeouts;
+    // pages replaced to make room, and those of them that were written back first
+    long long evictions;
+    long long dirtyEvictions;
+    // dirty pages written without being evicted: forcePage, forceFlushPool,
+    // the background writer and shutdown
+    long long flushes;
+    long long forces;
+    // latched pins that blocked on a frame latch held by another thread
+    long long pinWaits;
+    // pages read from and written to the page files
+    long long reads;
+    long long writes;
+    // replacement: LRU hits moved to the back of the order, pinned frames passed over
+    // while looking for a victim, scan ring frames reused, pages loaded by the prefetcher
+    long long lruPromotions;
+    long long pinnedSkips;
+    long long ringRecycles;
+    long long prefetchLoads;
+    // optimistic reads that gave up and took the shared latch
+    long long optimisticFallbacks;
+    // pages queued for the prefetcher from warm restart files
+    long long warmPages;
+    // misses the admission filter kept from displacing the policy's victim
+    long long admissionRejects;
+    // misses that evicted a batch of victims because of evictionBatch
+    long long victimBatches;
+    // buffered pages of each BM_PageClass
+    int classFrames[BM_NUM_PAGE_CLASSES];
+    // victim tier: misses served from it, evicted pages stored in it, and the pages it
+    // holds with the bytes they take (compressed data plus bookkeeping)
+    long long tierHits;
+    long long tierStores;
+    int tierPages;
+    long long tierBytes;
+    // weakest backing of the page data, and the bytes mapped or allocated for it
+    BM_ArenaBacking arenaBacking;
+    long long arenaBytes;
+} BM_PoolStats;
+
+// caller-held state of readPageOptimistic: the frame the page was last found in;
+// initialize with INIT_OPTIMISTIC_HANDLE, one handle per thread
+typedef struct BM_OptimisticHandle {
+    PageNumber pageNum;
+    int frame;
+    unsigned int layout;
+} BM_OptimisticHandle;
+
+#define INIT_OPTIMISTIC_HANDLE { NO_PAGE, NO_PAGE, 0 }
+
 // convenience macros
 #define MAKE_POOL()					\
 		((BM_BufferPool *) malloc (sizeof(BM_BufferPool)))
@@ -65,11 +285,26 @@ typedef struct BM_BufferPool {
 		((BM_PageHandle *) malloc (sizeof(BM_PageHandle)))
 
 // Buffer Manager Interface Pool Handling
+// stratData: NULL, or a BM_ReplacementPolicy to use instead of the strategy's built-in one
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
                   const int numPages, ReplacementStrategy strategy,
                   void *stratData);
+RC initBufferPoolWithOptions(BM_BufferPool *const bm, const char *const pageFileName,
+                             const int numPages, ReplacementStrategy strategy,
+                             void *stratData, const BM_PoolOptions *options);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
+// grow or shrink the pool without shutting it down; fails with RC_BUFFERPOOL_IN_USE
+// if pinned pages leave too few frames to evict
+RC resizeBufferPool(BM_BufferPool *const bm, const int newNumPages);
+
+// Buffer Manager Interface Shared Pool
+// one pool for all page files, frames are keyed by (file, page number); attachBufferPool
+// opens a file through it and shutdownBufferPool on that handle detaches the file again
+RC initSharedBufferPool(const BM_SharedPoolConfig *config);
+RC shutdownSharedBufferPool(void);
+bool sharedBufferPoolActive(void);
+RC attachBufferPool(BM_BufferPool *const bm, const char *const pageFileName);
 
 // Buffer Manager Interface Access Pages
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page);
@@ -77,6 +312,39 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page,
             const PageNumber pageNum);
+// tag a pinned page with its BM_PageClass; it keeps the class until it is evicted
+RC setPageClass (BM_BufferPool *const bm, BM_PageHandle *const page, BM_PageClass pageClass);
+
+// Buffer Manager Interface Access Rings
+// pinPageInRing loads missed pages into the ring's frames; unpin with unpinPage
+RC initAccessRing (BM_BufferPool *const bm, BM_AccessRing *ring, int numFrames);
+RC pinPageInRing (BM_BufferPool *const bm, BM_AccessRing *ring, BM_PageHandle *const page,
+                  const PageNumber pageNum);
+RC freeAccessRing (BM_AccessRing *ring);
+
+// Buffer Manager Interface Prefetching
+// load pages into unpinned frames in the background so a later pinPage hits
+RC prefetchPages (BM_BufferPool *const bm, const PageNumber *pageNums, int numPages);
+RC prefetchRange (BM_BufferPool *const bm, const PageNumber startPage, int numPages);
+
+// Buffer Manager Interface Latched Access
+// pinPageShared/pinPageExclusive also take the frame's read/write latch,
+// unpinPageLatched releases it and unpins; the pool is safe to share between threads
+RC pinPageShared (BM_BufferPool *const bm, BM_PageHandle *const page,
+                  const PageNumber pageNum);
+RC pinPageExclusive (BM_BufferPool *const bm, BM_PageHandle *const page,
+                     const PageNumber pageNum);
+RC unpinPageLatched (BM_BufferPool *const bm, BM_PageHandle *const page);
+
+// Buffer Manager Interface Optimistic Reads
+// copy part of a page without pinning it; writers of such pages use pinPageExclusive
+RC readPageOptimistic (BM_BufferPool *const bm, BM_OptimisticHandle *optimistic,
+                       const PageNumber pageNum, char *dest, int offset, int length);
+
+// Buffer Manager Interface Tracing
+// record every pin and unpin of the pool to a binary file for bm_sim
+RC startPoolTrace (BM_BufferPool *const bm, const char *traceFileName);
+RC stopPoolTrace (BM_BufferPool *const bm);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
@@ -84,5 +352,8 @@ bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+int getNumForcedPages (BM_BufferPool *const bm);
+long long getForceLatencyNanos (BM_BufferPool *const bm, bool slowest);
+BM_PoolStats getPoolStats (BM_BufferPool *const bm);
 
 #endif
@@ -7,6 +7,9 @@
 // local functions
 static void printStrat (BM_BufferPool *const bm);
 
+// names of the BM_ArenaBacking values
+static const char *arenaBackingNames[] = { "heap", "pages", "thp", "hugetlb" };
+
 // external functions
 void 
 printPoolContent (BM_BufferPool *const bm)
@@ -51,6 +54,37 @@ sprintPoolContent (BM_BufferPool *const bm)
 }
 
 
+// counters of getPoolStats, e.g. to size a pool by its hit ratio
+void
+printPoolStats (BM_BufferPool *const bm)
+{
+	BM_PoolStats stats = getPoolStats(bm);
+	long long pins = stats.hits + stats.misses;
+	BM_BufferPool current = *bm;
+
+	// the adaptive policy may have switched the strategy the handle was opened with
+	current.strategy = stats.strategy;
+	printf("{");
+	printStrat(&current);
+	printf(" %i}: hits=%lld misses=%lld hit ratio=%.4f\n", stats.numFrames, stats.hits, stats.misses,
+	       pins ? (double) stats.hits / pins : 0.0);
+	printf("  pin failures=%lld pin waits=%lld\n", stats.pinFailures, stats.pinWaits);
+	printf("  blocked pins=%lld blocked ms=%.3f pin timeouts=%lld\n", stats.blockedPins, stats.blockedNanos / 1e6,
+	       stats.pinTimeouts);
+	printf("  evictions=%lld dirty evictions=%lld victim batches=%lld flushes=%lld forces=%lld\n", stats.evictions,
+	       stats.dirtyEvictions, stats.victimBatches, stats.flushes, stats.forces);
+	printf("  reads=%lld writes=%lld\n", stats.reads, stats.writes);
+	printf("  lru promotions=%lld pinned skips=%lld ring recycles=%lld prefetch loads=%lld optimistic fallbacks=%lld\n",
+	       stats.lruPromotions, stats.pinnedSkips, stats.ringRecycles, stats.prefetchLoads, stats.optimisticFallbacks);
+	printf("  warm pages=%lld admission rejects=%lld policy switches=%lld\n", stats.warmPages, stats.admissionRejects,
+	       stats.policySwitches);
+	printf("  tier hits=%lld tier stores=%lld tier pages=%i tier bytes=%lld\n", stats.tierHits, stats.tierStores,
+	       stats.tierPages, stats.tierBytes);
+	printf("  data pages=%i index leaves=%i index inner nodes=%i headers=%i\n", stats.classFrames[BM_PAGE_DATA],
+	       stats.classFrames[BM_PAGE_INDEX_LEAF], stats.classFrames[BM_PAGE_INDEX_INNER], stats.classFrames[BM_PAGE_HEADER]);
+	printf("  arena=%s bytes=%lld\n", arenaBackingNames[stats.arenaBacking], stats.arenaBytes);
+}
+
 void
 printPageContent (BM_PageHandle *const page)
 {
@@ -5,6 +5,7 @@
 
 // debug functions
 void printPoolContent (BM_BufferPool *const bm);
+void printPoolStats (BM_BufferPool *const bm);
 void printPageContent (BM_PageHandle *const page);
 char *sprintPoolContent (BM_BufferPool *const bm);
 char *sprintPageContent (BM_PageHandle *const page);
@@ -9,27 +9,61 @@
 #include "dberror.h"
 
 #define MAX_ATTR_NAME_LEN 15
+// scans of tables larger than a quarter of the pool read through a private ring of
+// an eighth of the pool, at most SCAN_RING_MAX_FRAMES frames, instead of the whole
+// pool; pools smaller than SCAN_RING_MIN_POOL_FRAMES are too small to spare a ring
+#define SCAN_RING_POOL_FRACTION 4
+#define SCAN_RING_FRAME_FRACTION 8
+#define SCAN_RING_MAX_FRAMES 16
+#define SCAN_RING_MIN_POOL_FRAMES 32
 
 extern int getAttrPos (Schema *schema, int attrNum);
 static void prepareTableHeader(char **tableHeaderPtr, TableManager *tableManager, Schema *schema);
 static void populateSchemaDetails(char **tableHeaderPtr, Schema *schema);
 static void handleCleanup(BM_BufferPool *bufferPool, BM_PageHandle *pageHandle, TableManager *tableManager); 
+static RC readRecord(TableManager *tableManager, BM_AccessRing *ring, RID id, Record *record);
+static RC openTablePool(BM_BufferPool *bufferPool, char *name);
+
+// set while the record manager runs on the process-wide buffer pool
+static bool usingSharedPool = FALSE;
 
 
 /*************************
 *  Table and manager 
 **************************/
 
+// mgmtData optionally points to a BM_SharedPoolConfig sizing the shared buffer pool
 RC initRecordManager(void *mgmtData) {
+    RC result = initSharedBufferPool((const BM_SharedPoolConfig *)mgmtData);
+    if (result != RC_OK) {
+        return result;
+    }
+    usingSharedPool = TRUE;
     printf("Starting Record Manager...\n");
     return RC_OK;
 }
 
 RC shutdownRecordManager() {
+    if (usingSharedPool) {
+        RC result = shutdownSharedBufferPool();
+        if (result != RC_OK) {
+            return result;
+        }
+        usingSharedPool = FALSE;
+    }
     printf("Record Manager closed successfully.\n");
     return RC_OK;
 }
 
+// Open a table's page file through the shared pool, or a small private pool if the
+// record manager was not initialized
+static RC openTablePool(BM_BufferPool *bufferPool, char *name) {
+    if (usingSharedPool) {
+        return attachBufferPool(bufferPool, name);
+    }
+    return initBufferPool(bufferPool, name, 3, RS_FIFO, NULL);
+}
+
 void handleCleanup(BM_BufferPool *bufferPool, BM_PageHandle *pageHandle, TableManager *tableManager) {
     if (bufferPool == NULL || pageHandle == NULL || tableManager == NULL) return;
     
@@ -68,7 +102,7 @@ RC createTable(char *name, Schema *schema) {
     }
 
     // Step 2: Initialize the buffer pool
-    result = initBufferPool(bufferPool, name, 3, RS_FIFO, NULL);
+    result = openTablePool(bufferPool, name);
     if (result != RC_OK) {
         handleCleanup(bufferPool, pageHandle, tableManager);
         return result;
@@ -190,16 +224,17 @@ RC openTable(RM_TableData *rel, char *name) {
     }
 
     // Initialize buffer pool
-    resultCode = initBufferPool(bufferManager, name, 3, RS_FIFO, NULL);
+    resultCode = openTablePool(bufferManager, name);
     if (resultCode != RC_OK) {
         goto CLEANUP;
     }
 
-    // Pin the first page in the buffer pool
+    // Pin the first page in the buffer pool; scans of the data pages should not evict it
     resultCode = pinPage(bufferManager, pageHandle, 0);
     if (resultCode != RC_OK) {
         goto CLEANUP;
     }
+    setPageClass(bufferManager, pageHandle, BM_PAGE_HEADER);
 
     tableHeader = pageHandle->data;
 
@@ -289,8 +324,9 @@ RC closeTable(RM_TableData *rel) {
         *pageHeader++ = tableManager->firstFreeSlotNum;
         *pageHeader = tableManager->firstDataPageNum;
 
-        // Mark as dirty and unpin the page
-        if ((resultCode = markDirty(tableManager->bufferManagerPtr, tableManager->pageHandlePtr)) == RC_OK) {
+        // Mark as dirty, force the header to disk and unpin the page
+        if ((resultCode = markDirty(tableManager->bufferManagerPtr, tableManager->pageHandlePtr)) == RC_OK &&
+            (resultCode = forcePage(tableManager->bufferManagerPtr, tableManager->pageHandlePtr)) == RC_OK) {
             resultCode = unpinPage(tableManager->bufferManagerPtr, tableManager->pageHandlePtr);
         }
     } else {
@@ -355,7 +391,7 @@ RC insertRecord(RM_TableData *rel, Record *record) {
     // Pin the page for inserting the record
     RC pagePinStatus = pinPage(tableMgmt->bufferManagerPtr, pageHandle, tableMgmt->firstFreePageNum);
     if (pagePinStatus != RC_OK) {
-        return RC_ERROR;
+        return pagePinStatus;
     }
 
     char *currentPageData = pageHandle->data;
@@ -414,7 +450,11 @@ RC getRecord(RM_TableData *rel, RID id, Record *record) {
         return RC_GENERAL_ERROR;
     }
 
-    TableManager *tableManager = rel->mgmtData;
+    return readRecord(rel->mgmtData, NULL, id, record);
+}
+
+// Copy a record out of its page, pinning the page through the scan ring if one is given
+RC readRecord(TableManager *tableManager, BM_AccessRing *ring, RID id, Record *record) {
     int slotsPerRecord = (PAGE_SIZE - sizeof(PageHeader)) / (tableManager->recSize + 2);
 
     // Check if slot ID is within valid range
@@ -423,9 +463,10 @@ RC getRecord(RM_TableData *rel, RID id, Record *record) {
     }
 
     BM_PageHandle *pageHandler = tableManager->pageHandlePtr;
-    RC pinPageStatus = pinPage(tableManager->bufferManagerPtr, pageHandler, id.page);
+    RC pinPageStatus = ring ? pinPageInRing(tableManager->bufferManagerPtr, ring, pageHandler, id.page)
+                            : pinPage(tableManager->bufferManagerPtr, pageHandler, id.page);
     if (pinPageStatus != RC_OK) {
-        return RC_ERROR;
+        return pinPageStatus;
     }
 
     // Calculate location of the desired record in the page
@@ -459,7 +500,7 @@ RC updateRecord(RM_TableData *rel, Record *record) {
     BM_PageHandle *pageHandle = tableManager->pageHandlePtr;
     RC pinResult = pinPage(tableManager->bufferManagerPtr, pageHandle, record->id.page);
     if (pinResult != RC_OK) {
-        return RC_ERROR;
+        return pinResult;
     }
 
     // Locate the target slot and check if it's occupied
@@ -724,6 +765,24 @@ RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *conditionExpression)
         .conditionExpression = conditionExpression
     };
 
+    // Large tables are scanned through a ring so they do not flush the rest of the pool
+    BM_BufferPool *bufferPool = tableManager->bufferManagerPtr;
+    if (bufferPool->numPages >= SCAN_RING_MIN_POOL_FRAMES &&
+        tableManager->firstFreePageNum > bufferPool->numPages / SCAN_RING_POOL_FRACTION) {
+        int ringFrames = bufferPool->numPages / SCAN_RING_FRAME_FRACTION;
+        if (ringFrames > SCAN_RING_MAX_FRAMES) {
+            ringFrames = SCAN_RING_MAX_FRAMES;
+        }
+
+        scanManager->scanRing = (BM_AccessRing *)calloc(1, sizeof(BM_AccessRing));
+        if (scanManager->scanRing == NULL ||
+            initAccessRing(bufferPool, scanManager->scanRing, ringFrames) != RC_OK) {
+            free(scanManager->scanRing);
+            free(scanManager);
+            return RC_MEMORY_ALLOCATION_FAIL;
+        }
+    }
+
     scan->mgmtData = scanManager;
     scan->rel = rel;
 
@@ -759,7 +818,7 @@ RC next(RM_ScanHandle *scan, Record *record) {
         }
 
         RID currentRID = {.page = scanMgr->currentPageNum, .slot = scanMgr->currentSlotNum};
-        RC recordStatus = getRecord(tableData, currentRID, record);
+        RC recordStatus = readRecord(tableMgr, scanMgr->scanRing, currentRID, record);
         if (recordStatus == RC_OK) {
             scanMgr->scanIndex++;
 
@@ -786,6 +845,12 @@ RC closeScan(RM_ScanHandle *scan) {
         return RC_RECORD_NOT_FOUND;
     }
 
+    ScanManager *scanManager = scan->mgmtData;
+    if (scanManager->scanRing != NULL) {
+        freeAccessRing(scanManager->scanRing);
+        free(scanManager->scanRing);
+    }
+
     free(scan->mgmtData);
     scan->mgmtData = NULL;
 
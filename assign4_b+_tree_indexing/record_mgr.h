@@ -49,6 +49,7 @@ typedef struct ScanManager
      int currentSlotNum;
      Expr *conditionExpression;
      BM_PageHandle *scanPageHandlePtr;
+     BM_AccessRing *scanRing;
 }ScanManager;
 
 // table and manager
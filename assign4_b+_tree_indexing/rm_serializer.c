@@ -18,7 +18,7 @@ typedef struct VarString {
 			var = (VarString *) malloc(sizeof(VarString));	\
 			var->size = 0;					\
 			var->bufsize = 100;					\
-			var->buf = calloc(100,0);				\
+			var->buf = calloc(100,1);				\
 		} while (0)
 
 #define FREE_VARSTRING(var)			\
@@ -49,6 +49,7 @@ typedef struct VarString {
 				int newbufsize = var->bufsize;				\
 				while((newbufsize *= 2) < newsize);			\
 				var->buf = realloc(var->buf, newbufsize);			\
+				var->bufsize = newbufsize;					\
 			}								\
 		} while (0)
 
@@ -5,10 +5,18 @@
 #include<unistd.h>
 #include<string.h>
 #include<math.h>
+#include<limits.h>
+#include<sys/uio.h>
 
 #include "storage_mgr.h"
 #include "dberror.h"
 
+// pages per vectored read or write in readBlocks and writeBlocks
+#ifndef IOV_MAX
+#define IOV_MAX 16
+#endif
+#define WRITE_BLOCKS_MAX_RUN (IOV_MAX < 64 ? IOV_MAX : 64)
+
 
 /***********************************************
  *  Page File Management Module Implementation
@@ -101,6 +109,53 @@ RC readBlock(int pageNum, SM_FileHandle *fileHandle, SM_PageHandle memPage) {
     return RC_OK;
 }
 
+// Read numPages consecutive blocks starting at startPage, one vectored read per IOV_MAX pages;
+// every block must exist
+RC readBlocks(int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+    if (startPage < 0 || numPages < 0 || startPage + numPages > fHandle->totalNumPages) return RC_READ_NON_EXISTING_PAGE;
+
+    FILE *file = fHandle->mgmtInfo;
+    struct iovec iov[WRITE_BLOCKS_MAX_RUN];
+    int maxRun = WRITE_BLOCKS_MAX_RUN;
+
+    // Buffered stdio writes must reach the file before it is read around the buffer
+    if (fflush(file) != 0) return RC_READ_FAILED;
+
+    for (int done = 0; done < numPages; ) {
+        int run = numPages - done < maxRun ? numPages - done : maxRun;
+        for (int i = 0; i < run; i++) {
+            iov[i].iov_base = memPages[done + i];
+            iov[i].iov_len = PAGE_SIZE;
+        }
+
+        off_t offset = (off_t)(startPage + done + 1) * PAGE_SIZE;
+        size_t remaining = (size_t)run * PAGE_SIZE;
+        struct iovec *next = iov;
+        int count = run;
+        while (remaining > 0) {
+            ssize_t got = preadv(fileno(file), next, count, offset);
+            if (got <= 0) return RC_READ_FAILED;
+            remaining -= got;
+            offset += got;
+
+            // Short read: skip the filled iovecs and continue inside the partial one
+            while (count > 0 && (size_t)got >= next->iov_len) {
+                got -= next->iov_len;
+                next++;
+                count--;
+            }
+            if (count > 0) {
+                next->iov_base = (char *)next->iov_base + got;
+                next->iov_len -= got;
+            }
+        }
+        done += run;
+    }
+
+    if (numPages > 0) fHandle->curPagePos = startPage + numPages - 1;
+    return RC_OK;
+}
+
 // Read the first block
 RC readFirstBlock(SM_FileHandle *fileHandle, SM_PageHandle memPage) {
     return readBlock(0, fileHandle, memPage);
@@ -150,6 +205,59 @@ RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
     return RC_OK;
 }
 
+// Write numPages consecutive blocks starting at startPage, one vectored write per IOV_MAX pages
+RC writeBlocks(int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+    if (startPage < 0 || numPages < 0) return RC_WRITE_FAILED;
+
+    FILE *file = fHandle->mgmtInfo;
+    struct iovec iov[WRITE_BLOCKS_MAX_RUN];
+    int maxRun = WRITE_BLOCKS_MAX_RUN;
+
+    // Buffered stdio writes go out first, and the read buffer is dropped so later reads see these pages
+    if (fflush(file) != 0) return RC_WRITE_FAILED;
+
+    for (int done = 0; done < numPages; ) {
+        int run = numPages - done < maxRun ? numPages - done : maxRun;
+        for (int i = 0; i < run; i++) {
+            iov[i].iov_base = memPages[done + i];
+            iov[i].iov_len = PAGE_SIZE;
+        }
+
+        off_t offset = (off_t)(startPage + done + 1) * PAGE_SIZE;
+        size_t remaining = (size_t)run * PAGE_SIZE;
+        struct iovec *next = iov;
+        int count = run;
+        while (remaining > 0) {
+            ssize_t written = pwritev(fileno(file), next, count, offset);
+            if (written <= 0) return RC_WRITE_FAILED;
+            remaining -= written;
+            offset += written;
+
+            // Short write: skip the iovecs that went out and continue inside the partial one
+            while (count > 0 && (size_t)written >= next->iov_len) {
+                written -= next->iov_len;
+                next++;
+                count--;
+            }
+            if (count > 0) {
+                next->iov_base = (char *)next->iov_base + written;
+                next->iov_len -= written;
+            }
+        }
+        done += run;
+    }
+
+    fHandle->curPagePos = startPage + numPages - 1;
+    return RC_OK;
+}
+
+// Push the file's written blocks to stable storage
+RC syncPageFile(SM_FileHandle *fHandle) {
+    FILE *file = fHandle->mgmtInfo;
+    if (fflush(file) != 0 || fdatasync(fileno(file)) != 0) return RC_WRITE_FAILED;
+    return RC_OK;
+}
+
 // Write data to the current block in the page file
 RC writeCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
     return writeBlock(fHandle->curPagePos, fHandle, memPage);
@@ -172,12 +280,19 @@ RC appendEmptyBlock(SM_FileHandle *fHandle) {
     return RC_OK;
 }
 
-// Ensure the file has at least a certain number of pages by appending empty blocks
+// Ensure the file has at least a certain number of pages, growing it with empty blocks in one step
 RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle) {
-    while (fHandle->totalNumPages < numberOfPages) {
-        RC status = appendEmptyBlock(fHandle);
-        if (status != RC_OK) return status;
-    }
+    if (fHandle->totalNumPages >= numberOfPages) return RC_OK;
+
+    FILE *file = fHandle->mgmtInfo;
+    struct stat fileStat;
+    off_t requiredSize = (off_t)(numberOfPages + 1) * PAGE_SIZE;
+
+    if (fflush(file) != 0 || fstat(fileno(file), &fileStat) != 0) return RC_WRITE_FAILED;
+    if (fileStat.st_size < requiredSize && ftruncate(fileno(file), requiredSize) != 0) return RC_WRITE_FAILED;
+
+    fHandle->totalNumPages = numberOfPages;
+    fHandle->curPagePos = fHandle->totalNumPages - 1;
     return RC_OK;
 }
 
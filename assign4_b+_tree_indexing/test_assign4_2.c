@@ -0,0 +1,2429 @@
+#include "storage_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+// var to store the current test's name
+char *testName;
+
+// check whether two the content of a buffer pool is the same as an expected content
+// (given in the format produced by sprintPoolContent)
+#define ASSERT_EQUALS_POOL(expected,bm,message)			        \
+  do {									\
+    char *real;								\
+    char *_exp = (char *) (expected);                                   \
+    real = sprintPoolContent(bm);					\
+    if (strcmp((_exp),real) != 0)					\
+      {									\
+	printf("[%s-%s-L%i-%s] FAILED: expected <%s> but was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+	free(real);							\
+	exit(1);							\
+      }									\
+    printf("[%s-%s-L%i-%s] OK: expected <%s> and was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+    free(real);								\
+  } while(0)
+
+// the shared ASSERT_EQUALS_INT never fails, the buffer manager tests need one that does
+#define ASSERT_EQUALS_COUNT(expected,real,message)			\
+  do {									\
+    int _exp = (expected);						\
+    int _real = (real);							\
+    if (_exp != _real)							\
+      {									\
+	printf("[%s-%s-L%i-%s] FAILED: expected <%i> but was <%i>: %s\n",TEST_INFO, _exp, _real, message); \
+	exit(1);							\
+      }									\
+    printf("[%s-%s-L%i-%s] OK: expected <%i> and was <%i>: %s\n",TEST_INFO, _exp, _real, message); \
+  } while(0)
+
+// test and helper methods
+static void testCreatingAndReadingDummyPages (void);
+static void createDummyPages(BM_BufferPool *bm, int num);
+static void checkDummyPages(BM_BufferPool *bm, int num);
+
+static void testReadPage (void);
+
+static void testFIFO (void);
+static void testLRU (void);
+static void testLRUWithPinnedPages (void);
+static void testPartitionedPool (void);
+static void testBackgroundWriter (void);
+static void testPrefetch (void);
+static void testAccessRing (void);
+static void testSharedPool (void);
+static void testResizePool (void);
+static void testForceFlushPool (void);
+static void testForcePage (void);
+static void testOptimisticRead (void);
+static void testPoolStats (void);
+static void testPoolTrace (void);
+static void testCustomPolicy (void);
+static void testArenaBacking (void);
+static void testBlockingPin (void);
+static void *blockedPinWorker (void *arg);
+static void testWarmRestart (void);
+static void testAdmissionFilter (void);
+static void testPageClasses (void);
+static void testVictimTier (void);
+static void testClockAndLRUK (void);
+static void testAdaptivePolicy (void);
+static void testEvictionBatch (void);
+static void testWriteBackFailure (void);
+static void limitFileSize (bool limited);
+static void pinRounds (BM_BufferPool *bm, int rounds, int hotPages, int firstScanPage, int scanPages);
+static int scanAfterHotPages (BM_BufferPool *bm, BM_PoolOptions *options);
+static void *optimisticWriter (void *arg);
+static void *optimisticReader (void *arg);
+static void *optimisticResizer (void *arg);
+static void testConcurrentPins (int numPartitions);
+static void *concurrentPinWorker (void *arg);
+static void testConcurrentLoads (void);
+static void *concurrentLoadWorker (void *arg);
+
+// main method
+int
+main (void)
+{
+  initStorageManager();
+  testName = "";
+
+  testCreatingAndReadingDummyPages();
+  testReadPage();
+  testFIFO();
+  testLRU();
+  testLRUWithPinnedPages();
+  testPartitionedPool();
+  testBackgroundWriter();
+  testPrefetch();
+  testAccessRing();
+  testSharedPool();
+  testResizePool();
+  testForceFlushPool();
+  testForcePage();
+  testOptimisticRead();
+  testPoolStats();
+  testPoolTrace();
+  testCustomPolicy();
+  testArenaBacking();
+  testBlockingPin();
+  testWarmRestart();
+  testAdmissionFilter();
+  testPageClasses();
+  testVictimTier();
+  testClockAndLRUK();
+  testAdaptivePolicy();
+  testEvictionBatch();
+  testWriteBackFailure();
+  testConcurrentPins(1);
+  testConcurrentPins(2);
+  testConcurrentLoads();
+
+  printf("Test cases run successfully!!\n");
+  return 0;
+}
+
+// create n pages with content "Page X" and read them back to check whether the content is right
+void
+testCreatingAndReadingDummyPages (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  testName = "Creating and Reading Back Dummy Pages";
+
+  CHECK(createPageFile("testbuffer.bin"));
+
+  createDummyPages(bm, 22);
+  checkDummyPages(bm, 20);
+
+  createDummyPages(bm, 1000);
+  checkDummyPages(bm, 1000);
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  TEST_DONE();
+}
+
+
+void
+createDummyPages(BM_BufferPool *bm, int num)
+{
+  int i;
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+  for (i = 0; i < num; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", h->pageNum);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm,h));
+    }
+
+  CHECK(shutdownBufferPool(bm));
+
+  free(h);
+}
+
+void
+checkDummyPages(BM_BufferPool *bm, int num)
+{
+  int i;
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char *expected = malloc(sizeof(char) * 512);
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+  for (i = 0; i < num; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+
+      sprintf(expected, "%s-%i", "Page", h->pageNum);
+      if (strcmp(expected, h->data) != 0)
+        {
+          printf("[%s-%s-L%i-%s] FAILED: expected <%s> but was <%s>: reading back dummy page content\n", TEST_INFO, expected, h->data);
+          exit(1);
+        }
+
+      CHECK(unpinPage(bm,h));
+    }
+
+  CHECK(shutdownBufferPool(bm));
+
+  free(expected);
+  free(h);
+}
+
+void
+testReadPage ()
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Reading a page";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+  CHECK(pinPage(bm, h, 0));
+  CHECK(pinPage(bm, h, 0));
+
+  CHECK(markDirty(bm, h));
+
+  CHECK(unpinPage(bm,h));
+  CHECK(unpinPage(bm,h));
+
+  CHECK(forcePage(bm, h));
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+
+  TEST_DONE();
+}
+
+void
+testFIFO ()
+{
+  // expected results
+  const char *poolContents[] = {
+    "[0 0],[-1 0],[-1 0]" ,
+    "[0 0],[1 0],[-1 0]",
+    "[0 0],[1 0],[2 0]",
+    "[3 0],[1 0],[2 0]",
+    "[3 0],[4 0],[2 0]",
+    "[3 0],[4 1],[2 0]",
+    "[3 0],[4 1],[5x0]",
+    "[6x0],[4 1],[5x0]",
+    "[6x0],[4 1],[0x0]",
+    "[6x0],[4 0],[0x0]",
+    "[6 0],[4 0],[0 0]"
+  };
+  const int requests[] = {0,1,2,3,4,4,5,6,0};
+  const int numLinRequests = 5;
+  const int numChangeRequests = 3;
+
+  int i;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing FIFO page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+
+  createDummyPages(bm, 100);
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+  // reading some pages linearly with direct unpin and no modifications
+  for(i = 0; i < numLinRequests; i++)
+    {
+      pinPage(bm, h, requests[i]);
+      unpinPage(bm, h);
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+    }
+
+  // pin one page and test remainder
+  i = numLinRequests;
+  pinPage(bm, h, requests[i]);
+  ASSERT_EQUALS_POOL(poolContents[i],bm,"pool content after pin page");
+
+  // read pages and mark them as dirty
+  for(i = numLinRequests + 1; i < numLinRequests + numChangeRequests + 1; i++)
+    {
+      pinPage(bm, h, requests[i]);
+      markDirty(bm, h);
+      unpinPage(bm, h);
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+    }
+
+  // flush buffer pool to disk
+  i = numLinRequests + numChangeRequests + 1;
+  h->pageNum = 4;
+  unpinPage(bm, h);
+  ASSERT_EQUALS_POOL(poolContents[i],bm,"unpin last page");
+
+  i++;
+  forceFlushPool(bm);
+  ASSERT_EQUALS_POOL(poolContents[i],bm,"pool content after flush");
+
+  // check number of write IOs
+  ASSERT_EQUALS_COUNT(3, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_COUNT(8, getNumReadIO(bm), "check number of read I/Os");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test the LRU page replacement strategy
+void
+testLRU (void)
+{
+  // expected results
+  const char *poolContents[] = {
+    // read first five pages and directly unpin them
+    "[0 0],[-1 0],[-1 0],[-1 0],[-1 0]" ,
+    "[0 0],[1 0],[-1 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[2 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[2 0],[3 0],[-1 0]",
+    "[0 0],[1 0],[2 0],[3 0],[4 0]",
+    // use some of the page to create a fixed LRU order without changing pool content
+    "[0 0],[1 0],[2 0],[3 0],[4 0]",
+    "[0 0],[1 0],[2 0],[3 0],[4 0]",
+    "[0 0],[1 0],[2 0],[3 0],[4 0]",
+    "[0 0],[1 0],[2 0],[3 0],[4 0]",
+    "[0 0],[1 0],[2 0],[3 0],[4 0]",
+    // check that pages get evicted in LRU order
+    "[0 0],[1 0],[2 0],[5 0],[4 0]",
+    "[0 0],[1 0],[2 0],[5 0],[6 0]",
+    "[7 0],[1 0],[2 0],[5 0],[6 0]",
+    "[7 0],[1 0],[8 0],[5 0],[6 0]",
+    "[7 0],[9 0],[8 0],[5 0],[6 0]"
+  };
+  const int orderRequests[] = {3,4,0,2,1};
+  const int numLRUOrderChange = 5;
+
+  int i;
+  int snapshot = 0;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing LRU page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 5, RS_LRU, NULL));
+
+  // reading first five pages linearly with direct unpin and no modifications
+  for(i = 0; i < 5; i++)
+  {
+      pinPage(bm, h, i);
+      unpinPage(bm, h);
+      ASSERT_EQUALS_POOL(poolContents[snapshot], bm, "check pool content reading in pages");
+      snapshot++;
+  }
+
+  // read pages to change LRU order
+  for(i = 0; i < numLRUOrderChange; i++)
+  {
+      pinPage(bm, h, orderRequests[i]);
+      unpinPage(bm, h);
+      ASSERT_EQUALS_POOL(poolContents[snapshot], bm, "check pool content using pages");
+      snapshot++;
+  }
+
+  // replace pages and check that it happens in LRU order
+  for(i = 0; i < 5; i++)
+  {
+      pinPage(bm, h, 5 + i);
+      unpinPage(bm, h);
+      ASSERT_EQUALS_POOL(poolContents[snapshot], bm, "check pool content using pages");
+      snapshot++;
+  }
+
+  // check number of write IOs
+  ASSERT_EQUALS_COUNT(0, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_COUNT(10, getNumReadIO(bm), "check number of read I/Os");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// pinned pages are skipped by LRU eviction and keep their place in the order
+void
+testLRUWithPinnedPages (void)
+{
+  const char *poolContents[] = {
+    "[0 1],[1 0],[2 0]",
+    "[0 1],[3 0],[2 0]",
+    "[0 1],[3 0],[4 0]",
+    "[0 0],[3 0],[4 0]",
+    "[5 0],[3 0],[4 0]"
+  };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+  int i;
+  testName = "Testing LRU page replacement with pinned pages";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+
+  // page 0 is the least recently used page but stays pinned
+  CHECK(pinPage(bm, pinned, 0));
+  for (i = 1; i < 3; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_POOL(poolContents[0], bm, "pinned page stays in the pool");
+
+  CHECK(pinPage(bm, h, 3));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL(poolContents[1], bm, "pinned LRU page is skipped");
+
+  CHECK(pinPage(bm, h, 4));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL(poolContents[2], bm, "next unpinned page is evicted");
+
+  // once unpinned the old page is the eviction candidate again
+  CHECK(unpinPage(bm, pinned));
+  ASSERT_EQUALS_POOL(poolContents[3], bm, "unpin the old page");
+
+  CHECK(pinPage(bm, h, 5));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL(poolContents[4], bm, "old page is evicted first");
+  ASSERT_EQUALS_COUNT(0, strcmp(h->data, "Page-5"), "evicted frame holds the new page");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  free(pinned);
+  TEST_DONE();
+}
+
+// read pages back through a pool split into partitions, every resident page sits in
+// exactly one frame and the I/O counters add up over all partitions
+void
+testPartitionedPool (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { 4 };
+  char expected[32];
+  PageNumber *frameContents;
+  int i, j, resident, found;
+  testName = "Testing partitioned pool";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 8, RS_LRU, NULL, &options));
+
+  for (i = 0; i < 100; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_COUNT(0, strcmp(expected, h->data), "partitioned pool reads the right page");
+      CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_COUNT(100, getNumReadIO(bm), "every page read once");
+  ASSERT_EQUALS_COUNT(0, getNumWriteIO(bm), "clean pages are never written");
+
+  // pages resident in the pool are hits, the read count does not move
+  frameContents = getFrameContents(bm);
+  resident = 0;
+  for (i = 0; i < 8; i++)
+    {
+      if (frameContents[i] == NO_PAGE)
+        continue;
+      resident++;
+      found = 0;
+      for (j = 0; j < 8; j++)
+        if (frameContents[j] == frameContents[i])
+          found++;
+      ASSERT_EQUALS_COUNT(1, found, "page buffered in a single frame");
+      CHECK(pinPage(bm, h, frameContents[i]));
+      CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_COUNT(8, resident, "all frames in use");
+  ASSERT_EQUALS_COUNT(100, getNumReadIO(bm), "resident pages are hits");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// dirtying half of the pool wakes the background writer, which writes pages back
+// until only the low watermark is left dirty
+void
+testBackgroundWriter (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { 2, 50, 25 };
+  PageNumber *frameContents;
+  bool *dirtyFlags;
+  int i, dirty, waited;
+  testName = "Testing background writer";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 16, RS_LRU, NULL, &options));
+
+  // below the high watermark nothing is written
+  for (i = 0; i < 7; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", i);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+    }
+  usleep(50 * 1000);
+  ASSERT_EQUALS_COUNT(0, getNumWriteIO(bm), "no writes below the high watermark");
+
+  // the eighth dirty page reaches 50%, the writer stops at 25% (4 frames)
+  CHECK(pinPage(bm, h, 7));
+  sprintf(h->data, "%s-%i", "Page", 7);
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  for (waited = 0; getNumWriteIO(bm) < 4 && waited < 1000; waited++)
+    usleep(1000);
+  usleep(20 * 1000);
+  ASSERT_EQUALS_COUNT(4, getNumWriteIO(bm), "writer flushes down to the low watermark");
+
+  dirtyFlags = getDirtyFlags(bm);
+  dirty = 0;
+  for (i = 0; i < 16; i++)
+    if (dirtyFlags[i])
+      dirty++;
+  ASSERT_EQUALS_COUNT(4, dirty, "low watermark of dirty frames left");
+
+  // the lowest page numbers went first
+  frameContents = getFrameContents(bm);
+  for (i = 0; i < 16; i++)
+    if (frameContents[i] != NO_PAGE)
+      ASSERT_EQUALS_COUNT(frameContents[i] >= 4, dirtyFlags[i], "written in page number order");
+
+  CHECK(shutdownBufferPool(bm));
+  checkDummyPages(bm, 8);
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// prefetched pages are loaded in the background and later pins hit without reading
+void
+testPrefetch (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  PageNumber pageList[] = { 50, 3, 77, 12 };
+  PageNumber expectedPages[] = { 10, 11, 12, 13, 14, 15, 16, 17, 50, 3, 77 };
+  char expected[32];
+  int i, waited;
+  testName = "Testing prefetching";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 16, RS_LRU, NULL));
+
+  CHECK(prefetchRange(bm, 10, 8));
+  CHECK(prefetchPages(bm, pageList, 4));
+  for (waited = 0; getNumReadIO(bm) < 11 && waited < 1000; waited++)
+    usleep(1000);
+  usleep(20 * 1000);
+  ASSERT_EQUALS_COUNT(11, getNumReadIO(bm), "each prefetched page read once");
+
+  for (i = 0; i < 11; i++)
+    {
+      CHECK(pinPage(bm, h, expectedPages[i]));
+      sprintf(expected, "%s-%i", "Page", expectedPages[i]);
+      ASSERT_EQUALS_COUNT(0, strcmp(expected, h->data), "prefetched page content");
+      CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_COUNT(11, getNumReadIO(bm), "pins of prefetched pages are hits");
+
+  // prefetched pages are not pinned, so the pool shuts down cleanly
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  // a failed read leaves the claimed frames free instead of installing empty pages:
+  // the file is cut short behind the pool's back, after page 1
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 8, RS_FIFO, NULL));
+  ASSERT_TRUE(truncate("testbuffer.bin", 3 * PAGE_SIZE) == 0, "page file cut short");
+  CHECK(prefetchRange(bm, 4, 4));
+  usleep(50 * 1000);
+  CHECK(prefetchRange(bm, 0, 1));
+  for (waited = 0; getNumReadIO(bm) < 1 && waited < 1000; waited++)
+    usleep(1000);
+  usleep(20 * 1000);
+  ASSERT_EQUALS_COUNT(1, getNumReadIO(bm), "only the readable page counted");
+  ASSERT_EQUALS_COUNT(1, (int) getPoolStats(bm).prefetchLoads, "one prefetched page");
+  CHECK(pinPage(bm, h, 0));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_COUNT(1, getNumReadIO(bm), "readable page prefetched");
+  CHECK(pinPage(bm, h, 4));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_COUNT(2, getNumReadIO(bm), "failed page not installed");
+  ASSERT_EQUALS_POOL("[0 0],[4 0],[-1 0],[-1 0],[-1 0],[-1 0],[-1 0],[-1 0]", bm, "failed run's frames free");
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// a scan through a 2-frame ring keeps recycling its own frames and leaves the hot
+// pages of the pool in place
+void
+testAccessRing (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_AccessRing ring;
+  PageNumber *frameContents;
+  char expected[32];
+  int i, j, resident, found;
+  testName = "Testing access ring for scans";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 8, RS_LRU, NULL));
+
+  // hot pages fill six of the eight frames
+  for (i = 0; i < 6; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+
+  CHECK(initAccessRing(bm, &ring, 2));
+  for (i = 20; i < 100; i++)
+    {
+      CHECK(pinPageInRing(bm, &ring, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_COUNT(0, strcmp(expected, h->data), "scan reads the right page");
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(freeAccessRing(&ring));
+  ASSERT_EQUALS_COUNT(86, getNumReadIO(bm), "every page read once");
+
+  // the hot pages are still buffered, the scan only left its last two pages behind
+  frameContents = getFrameContents(bm);
+  for (i = 0; i < 6; i++)
+    {
+      found = 0;
+      for (j = 0; j < 8; j++)
+        if (frameContents[j] == i)
+          found++;
+      ASSERT_EQUALS_COUNT(1, found, "hot page survives the scan");
+    }
+  resident = 0;
+  for (j = 0; j < 8; j++)
+    if (frameContents[j] >= 98)
+      resident++;
+  ASSERT_EQUALS_COUNT(2, resident, "scan pages confined to the ring");
+
+  // a normal miss takes a cold ring frame before any hot page
+  CHECK(pinPage(bm, h, 10));
+  CHECK(unpinPage(bm, h));
+  frameContents = getFrameContents(bm);
+  resident = 0;
+  for (j = 0; j < 8; j++)
+    if (frameContents[j] < 6)
+      resident++;
+  ASSERT_EQUALS_COUNT(6, resident, "hot pages outlive ring pages");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// two page files cached by one shared pool: frames are keyed by file and page,
+// each handle only sees its own file's frames, detaching writes the file back
+void
+testSharedPool (void)
+{
+  BM_BufferPool *first = MAKE_POOL();
+  BM_BufferPool *second = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_SharedPoolConfig config = { 4, RS_LRU, { 0, 0, 0 } };
+  PageNumber *frameContents;
+  char expected[32];
+  int i, j, resident;
+  testName = "Testing shared pool across files";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(first, 10);
+  CHECK(createPageFile("testshared.bin"));
+
+  ASSERT_EQUALS_COUNT(RC_FILE_HANDLE_NOT_INIT, attachBufferPool(first, "testbuffer.bin"), "attach needs a shared pool");
+  CHECK(initSharedBufferPool(&config));
+  CHECK(initSharedBufferPool(NULL));
+  CHECK(attachBufferPool(first, "testbuffer.bin"));
+  CHECK(attachBufferPool(second, "testshared.bin"));
+  ASSERT_EQUALS_COUNT(4, first->numPages, "first user sizes the pool");
+
+  // the same page number of both files lives in two frames
+  for (i = 0; i < 2; i++)
+    {
+      CHECK(pinPage(first, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_COUNT(0, strcmp(expected, h->data), "first file page read through shared pool");
+      CHECK(unpinPage(first, h));
+
+      CHECK(pinPage(second, h, i));
+      sprintf(h->data, "%s-%i", "Shared", i);
+      CHECK(markDirty(second, h));
+      CHECK(unpinPage(second, h));
+    }
+
+  frameContents = getFrameContents(first);
+  resident = 0;
+  for (j = 0; j < 4; j++)
+    if (frameContents[j] != NO_PAGE)
+      resident++;
+  ASSERT_EQUALS_COUNT(2, resident, "first handle sees only its own frames");
+  frameContents = getFrameContents(second);
+  resident = 0;
+  for (j = 0; j < 4; j++)
+    if (frameContents[j] != NO_PAGE)
+      resident++;
+  ASSERT_EQUALS_COUNT(2, resident, "second handle sees only its own frames");
+
+  // pages of the first file push out the second file's dirty pages
+  for (i = 2; i < 6; i++)
+    {
+      CHECK(pinPage(first, h, i));
+      CHECK(unpinPage(first, h));
+    }
+  ASSERT_EQUALS_COUNT(2, getNumWriteIO(second), "evicted pages written to their own file");
+  CHECK(shutdownSharedBufferPool());
+  ASSERT_EQUALS_COUNT(RC_BUFFERPOOL_IN_USE, shutdownSharedBufferPool(), "last user cannot leave with files attached");
+
+  CHECK(pinPage(second, h, 1));
+  ASSERT_EQUALS_COUNT(0, strcmp("Shared-1", h->data), "evicted page read back from its own file");
+  ASSERT_EQUALS_COUNT(RC_BUFFERPOOL_IN_USE, shutdownBufferPool(second), "pinned file cannot detach");
+  CHECK(unpinPage(second, h));
+
+  CHECK(shutdownBufferPool(first));
+  CHECK(shutdownBufferPool(second));
+  CHECK(shutdownSharedBufferPool());
+  ASSERT_EQUALS_COUNT(RC_SHUTDOWN_WITHOUT_INIT, shutdownSharedBufferPool(), "pool already gone");
+
+  checkDummyPages(first, 10);
+  CHECK(initBufferPool(second, "testshared.bin", 3, RS_FIFO, NULL));
+  for (i = 0; i < 2; i++)
+    {
+      CHECK(pinPage(second, h, i));
+      sprintf(expected, "%s-%i", "Shared", i);
+      ASSERT_EQUALS_COUNT(0, strcmp(expected, h->data), "shared pool pages written back");
+      CHECK(unpinPage(second, h));
+    }
+  CHECK(shutdownBufferPool(second));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  CHECK(destroyPageFile("testshared.bin"));
+
+  free(first);
+  free(second);
+  free(h);
+  TEST_DONE();
+}
+
+// growing keeps every buffered page, shrinking evicts unpinned pages and writes back
+// dirty ones; pinned pages keep their data in place throughout
+void
+testResizePool (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { 2, 0, 0 };
+  PageNumber *frameContents;
+  char *pinnedData;
+  char expected[32];
+  int i, j, resident;
+  testName = "Testing buffer pool resizing";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 20);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+
+  CHECK(pinPage(bm, pinned, 0));
+  pinnedData = pinned->data;
+  for (i = 1; i < 4; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(pinPage(bm, h, 3));
+  sprintf(h->data, "%s-%i", "Resized", 3);
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+
+  // grow: the four pages stay buffered and four more fit without evictions
+  CHECK(resizeBufferPool(bm, 8));
+  ASSERT_EQUALS_COUNT(8, bm->numPages, "pool grown");
+  ASSERT_EQUALS_COUNT(1, pinnedData == pinned->data, "pinned page data stays in place");
+  for (i = 0; i < 8; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_COUNT(8, getNumReadIO(bm), "no page read twice after growing");
+  ASSERT_EQUALS_COUNT(0, getNumWriteIO(bm), "nothing evicted while growing");
+
+  // shrink: six unpinned pages go, the dirty one is written back, the pinned one stays
+  CHECK(resizeBufferPool(bm, 2));
+  ASSERT_EQUALS_COUNT(2, bm->numPages, "pool shrunk");
+  ASSERT_EQUALS_COUNT(1, getNumWriteIO(bm), "evicted dirty page written");
+  frameContents = getFrameContents(bm);
+  resident = 0;
+  for (j = 0; j < 2; j++)
+    if (frameContents[j] == 0)
+      resident++;
+  ASSERT_EQUALS_COUNT(1, resident, "pinned page survives the shrink");
+  ASSERT_EQUALS_COUNT(0, strcmp("Page-0", pinned->data), "pinned page content intact");
+
+  // both frames pinned: nothing left to evict
+  CHECK(pinPage(bm, h, 5));
+  ASSERT_EQUALS_COUNT(RC_BUFFERPOOL_IN_USE, resizeBufferPool(bm, 1), "pinned pages block the shrink");
+  ASSERT_EQUALS_COUNT(2, bm->numPages, "failed shrink leaves the pool alone");
+  ASSERT_EQUALS_COUNT(RC_ERROR, resizeBufferPool(bm, 0), "pool needs a frame");
+  CHECK(unpinPage(bm, h));
+  CHECK(unpinPage(bm, pinned));
+
+  CHECK(pinPage(bm, h, 3));
+  ASSERT_EQUALS_COUNT(0, strcmp("Resized-3", h->data), "written back page read again");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  // a partitioned pool keeps at least one frame per partition
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_LRU, NULL, &options));
+  CHECK(resizeBufferPool(bm, 9));
+  for (i = 0; i < 20; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", i == 3 ? "Resized" : "Page", i);
+      ASSERT_EQUALS_COUNT(0, strcmp(expected, h->data), "partitioned pool reads after growing");
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(resizeBufferPool(bm, 2));
+  ASSERT_EQUALS_COUNT(RC_ERROR, resizeBufferPool(bm, 1), "one frame per partition");
+  for (i = 19; i >= 0; i--)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", i == 3 ? "Resized" : "Page", i);
+      ASSERT_EQUALS_COUNT(0, strcmp(expected, h->data), "partitioned pool reads after shrinking");
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  free(pinned);
+  TEST_DONE();
+}
+
+// forceFlushPool writes the unpinned dirty pages in page order to their own blocks
+// (behind the file header) and leaves pinned pages dirty
+void
+testForceFlushPool (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+  char expected[32];
+  bool *dirtyFlags;
+  int i;
+  testName = "Testing forced flush of the pool";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 8, RS_FIFO, NULL));
+
+  // pages 7..0 in reverse, page 3 stays clean, page 5 stays pinned
+  for (i = 7; i >= 0; i--)
+    {
+      CHECK(pinPage(bm, h, i));
+      if (i == 3)
+        {
+          CHECK(unpinPage(bm, h));
+          continue;
+        }
+      sprintf(h->data, "%s-%i", "Flushed", i);
+      CHECK(markDirty(bm, h));
+      if (i == 5)
+        *pinned = *h;
+      else
+        CHECK(unpinPage(bm, h));
+    }
+
+  CHECK(forceFlushPool(bm));
+  ASSERT_EQUALS_COUNT(6, getNumWriteIO(bm), "unpinned dirty pages written once");
+  dirtyFlags = getDirtyFlags(bm);
+  for (i = 0; i < 8; i++)
+    ASSERT_EQUALS_COUNT(getFrameContents(bm)[i] == 5, dirtyFlags[i], "only the pinned page stays dirty");
+
+  CHECK(forceFlushPool(bm));
+  ASSERT_EQUALS_COUNT(6, getNumWriteIO(bm), "clean pages are not written again");
+  CHECK(unpinPage(bm, pinned));
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  for (i = 0; i < 8; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      if (i == 3)
+        ASSERT_EQUALS_COUNT(0, h->data[0], "untouched page stays empty");
+      else
+        {
+          sprintf(expected, "%s-%i", "Flushed", i);
+          ASSERT_EQUALS_COUNT(0, strcmp(expected, h->data), "flushed page lands in its own block");
+        }
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  free(pinned);
+  TEST_DONE();
+}
+
+// forcePage writes the page to its block right away (optionally synced) and records
+// how long that took
+void
+testForcePage (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { 0, 0, 0, 1 };
+  char block[PAGE_SIZE];
+  FILE *file;
+  int sync;
+  testName = "Testing forcePage write-through";
+
+  for (sync = 0; sync < 2; sync++)
+    {
+      CHECK(createPageFile("testbuffer.bin"));
+      CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_FIFO, NULL, sync ? &options : NULL));
+
+      CHECK(pinPage(bm, h, 2));
+      sprintf(h->data, "%s-%i", "Forced", 2);
+      CHECK(markDirty(bm, h));
+      CHECK(forcePage(bm, h));
+      ASSERT_EQUALS_COUNT(0, getDirtyFlags(bm)[0], "forced page is clean");
+      ASSERT_EQUALS_COUNT(1, getNumWriteIO(bm), "forced page written");
+      ASSERT_EQUALS_COUNT(1, getNumForcedPages(bm), "force counted");
+      ASSERT_EQUALS_COUNT(1, getForceLatencyNanos(bm, FALSE) > 0, "force latency recorded");
+      ASSERT_EQUALS_COUNT(1, getForceLatencyNanos(bm, TRUE) <= getForceLatencyNanos(bm, FALSE), "slowest force within total");
+
+      // the block is on disk behind the file header while the pool is still open
+      file = fopen("testbuffer.bin", "r");
+      ASSERT_TRUE(file != NULL, "page file opened");
+      fseek(file, (2 + 1) * PAGE_SIZE, SEEK_SET);
+      ASSERT_EQUALS_COUNT(1, (int) fread(block, PAGE_SIZE, 1, file), "forced block present");
+      ASSERT_EQUALS_COUNT(0, strcmp("Forced-2", block), "forced block content");
+      fclose(file);
+
+      CHECK(unpinPage(bm, h));
+      h->pageNum = 7;
+      ASSERT_EQUALS_COUNT(RC_WRITE_FAILED, forcePage(bm, h), "page not buffered");
+      CHECK(shutdownBufferPool(bm));
+      CHECK(destroyPageFile("testbuffer.bin"));
+    }
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// getPoolStats counts hits, misses, evictions and write-backs of the whole pool
+void
+testPoolStats (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle pinned[3];
+  BM_PoolStats stats;
+  int i;
+  testName = "Testing buffer pool statistics";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(0, (int) (stats.hits + stats.misses + stats.evictions), "fresh pool counts nothing");
+  ASSERT_EQUALS_COUNT(3, stats.numFrames, "frames reported");
+  ASSERT_EQUALS_COUNT(RS_LRU, stats.strategy, "strategy reported");
+
+  // pages 0..2 miss, page 0 hits and moves to the back, page 1 is dirtied
+  for (i = 0; i < 3; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      if (i == 1)
+        CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(pinPage(bm, h, 0));
+  CHECK(unpinPage(bm, h));
+
+  // page 3 evicts the least recently used page 1, which is written back first
+  CHECK(pinPage(bm, h, 3));
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(1, (int) stats.hits, "one hit");
+  ASSERT_EQUALS_COUNT(4, (int) stats.misses, "four misses");
+  ASSERT_EQUALS_COUNT(1, (int) stats.lruPromotions, "hit moved to the back");
+  ASSERT_EQUALS_COUNT(1, (int) stats.evictions, "one eviction");
+  ASSERT_EQUALS_COUNT(1, (int) stats.dirtyEvictions, "evicted page was dirty");
+  ASSERT_EQUALS_COUNT(4, (int) stats.reads, "pages read");
+  ASSERT_EQUALS_COUNT(1, (int) stats.writes, "eviction write");
+  ASSERT_EQUALS_COUNT(0, (int) stats.flushes, "nothing flushed yet");
+
+  CHECK(forceFlushPool(bm));
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(1, (int) stats.flushes, "dirty page 3 flushed");
+  ASSERT_EQUALS_COUNT(2, (int) stats.writes, "flush write");
+  ASSERT_EQUALS_COUNT(getNumWriteIO(bm), (int) stats.writes, "writes match getNumWriteIO");
+  ASSERT_EQUALS_COUNT(getNumReadIO(bm), (int) stats.reads, "reads match getNumReadIO");
+
+  // with every frame pinned a miss fails after passing over the pinned frames
+  for (i = 0; i < 3; i++)
+    CHECK(pinPage(bm, &pinned[i], 4 + i));
+  ASSERT_EQUALS_COUNT(RC_BUFFERPOOL_FULL, pinPage(bm, h, 9), "pool full");
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(1, (int) stats.pinFailures, "failed pin counted");
+  ASSERT_EQUALS_COUNT(3, (int) stats.pinnedSkips, "pinned frames passed over");
+  for (i = 0; i < 3; i++)
+    CHECK(unpinPage(bm, &pinned[i]));
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// startPoolTrace records pins and unpins (latched ones too) until stopPoolTrace
+void
+testPoolTrace (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_TraceHeader header;
+  BM_TraceRecord records[8];
+  PageNumber expectedPages[] = { 3, 3, 5, 5, 3 };
+  char expectedOps[] = { TRACE_PIN, TRACE_UNPIN, TRACE_PIN, TRACE_UNPIN, TRACE_PIN };
+  FILE *file;
+  int i, numRecords;
+  testName = "Testing pin/unpin traces";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+
+  // not traced yet
+  CHECK(pinPage(bm, h, 1));
+  CHECK(unpinPage(bm, h));
+
+  CHECK(startPoolTrace(bm, "testtrace.bin"));
+  ASSERT_EQUALS_COUNT(RC_ERROR, startPoolTrace(bm, "testtrace.bin"), "trace already running");
+  CHECK(pinPage(bm, h, 3));
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  CHECK(pinPageShared(bm, h, 5));
+  CHECK(unpinPageLatched(bm, h));
+  CHECK(pinPage(bm, h, 3));
+  CHECK(stopPoolTrace(bm));
+  CHECK(unpinPage(bm, h));
+  CHECK(stopPoolTrace(bm));
+
+  file = fopen("testtrace.bin", "rb");
+  ASSERT_TRUE(file != NULL, "trace file written");
+  ASSERT_EQUALS_COUNT(1, (int) fread(&header, sizeof(BM_TraceHeader), 1, file), "trace header present");
+  ASSERT_EQUALS_COUNT(BM_TRACE_MAGIC, header.magic, "trace magic");
+  ASSERT_EQUALS_COUNT(3, header.numPages, "traced pool size");
+  ASSERT_EQUALS_COUNT(RS_LRU, header.strategy, "traced pool strategy");
+  numRecords = (int) fread(records, sizeof(BM_TraceRecord), 8, file);
+  fclose(file);
+
+  ASSERT_EQUALS_COUNT(5, numRecords, "pins and unpins between start and stop");
+  for (i = 0; i < numRecords; i++)
+    {
+      ASSERT_EQUALS_COUNT(expectedPages[i], records[i].pageNum, "traced page");
+      ASSERT_EQUALS_COUNT(expectedOps[i], records[i].op, "traced operation");
+      ASSERT_EQUALS_COUNT(1, i == 0 || records[i].timestamp >= records[i - 1].timestamp, "timestamps ascend");
+    }
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+  remove("testtrace.bin");
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// state of the MRU test policy: last use of each frame and callback counts
+typedef struct MruPolicy {
+  int numFrames;
+  long *lastUse;
+  long clock;
+  int resizes;
+  int loads;
+  int evictions;
+  int unpins;
+} MruPolicy;
+
+static void
+mruResize (void *state, int numFrames)
+{
+  MruPolicy *mru = state;
+  mru->lastUse = realloc(mru->lastUse, numFrames * sizeof(long));
+  memset(mru->lastUse, 0, numFrames * sizeof(long));
+  mru->numFrames = numFrames;
+  mru->resizes++;
+}
+
+static void
+mruLoad (void *state, int frame, bool cold)
+{
+  MruPolicy *mru = state;
+  mru->lastUse[frame] = ++mru->clock;
+  mru->loads++;
+}
+
+static void
+mruHit (void *state, int frame)
+{
+  MruPolicy *mru = state;
+  mru->lastUse[frame] = ++mru->clock;
+}
+
+static void
+mruUnpin (void *state, int frame)
+{
+  ((MruPolicy *) state)->unpins++;
+}
+
+static void
+mruEvict (void *state, int frame)
+{
+  ((MruPolicy *) state)->evictions++;
+}
+
+// replace the most recently used unpinned frame
+static int
+mruChooseVictim (void *state, int firstFrame, int numFrames, const BM_PageFrame *frames)
+{
+  MruPolicy *mru = state;
+  int victim = NO_PAGE;
+  int frame;
+
+  for (frame = firstFrame; frame < firstFrame + numFrames; frame++)
+    if (frames[frame].fixCount == 0 && (victim == NO_PAGE || mru->lastUse[frame] > mru->lastUse[victim]))
+      victim = frame;
+  return victim;
+}
+
+// a BM_ReplacementPolicy passed as stratData takes over victim selection
+void
+testCustomPolicy (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  MruPolicy mru;
+  BM_ReplacementPolicy policy = { &mru, mruResize, mruLoad, mruHit, mruUnpin, mruEvict, mruChooseVictim };
+  int i;
+  testName = "Testing a custom replacement policy";
+
+  memset(&mru, 0, sizeof(MruPolicy));
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, &policy));
+  ASSERT_EQUALS_COUNT(1, mru.resizes, "policy sized at creation");
+  ASSERT_EQUALS_COUNT(3, mru.numFrames, "policy sized to the pool");
+
+  for (i = 0; i < 3; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(pinPage(bm, h, 0));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0]", bm, "pool filled");
+
+  // FIFO would replace page 0, MRU replaces the page used last
+  CHECK(pinPage(bm, h, 3));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[3 0],[1 0],[2 0]", bm, "most recently used page replaced");
+  CHECK(pinPage(bm, h, 4));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[4 0],[1 0],[2 0]", bm, "most recently loaded page replaced");
+  ASSERT_EQUALS_COUNT(5, mru.loads, "loads reported");
+  ASSERT_EQUALS_COUNT(2, mru.evictions, "evictions reported");
+  ASSERT_EQUALS_COUNT(6, mru.unpins, "unpins reported");
+
+  // a resize renumbers the frames: the policy is resized and sees the pages again
+  CHECK(resizeBufferPool(bm, 4));
+  ASSERT_EQUALS_COUNT(2, mru.resizes, "policy resized");
+  ASSERT_EQUALS_COUNT(4, mru.numFrames, "policy sized to the new pool");
+  ASSERT_EQUALS_COUNT(8, mru.loads, "buffered pages reloaded into the policy");
+  CHECK(pinPage(bm, h, 5));
+  CHECK(unpinPage(bm, h));
+  CHECK(pinPage(bm, h, 6));
+  ASSERT_EQUALS_COUNT(0, strcmp("Page-6", h->data), "page read after resize");
+  CHECK(unpinPage(bm, h));
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(mru.lastUse);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// page data of large pools is mapped in huge-page multiples, small pools use the heap
+void
+testArenaBacking (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolStats stats;
+  int i;
+  testName = "Testing the frame arena backing";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(ARENA_HEAP, stats.arenaBacking, "small pool on the heap");
+  ASSERT_EQUALS_COUNT(3 * PAGE_SIZE, (int) stats.arenaBytes, "small pool arena size");
+  CHECK(shutdownBufferPool(bm));
+
+  // 1024 frames are two huge pages; whichever backing was obtained, the pool works
+  CHECK(initBufferPool(bm, "testbuffer.bin", 1024, RS_LRU, NULL));
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(1, stats.arenaBacking != ARENA_HEAP, "large pool mapped");
+  ASSERT_EQUALS_COUNT(1024 * PAGE_SIZE, (int) stats.arenaBytes, "large pool arena size");
+  for (i = 0; i < 1024; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", i);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+    }
+
+  // growing by a huge page maps another chunk
+  CHECK(resizeBufferPool(bm, 1536));
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(1536 * PAGE_SIZE, (int) stats.arenaBytes, "grown arena size");
+  CHECK(pinPage(bm, h, 1535));
+  CHECK(unpinPage(bm, h));
+  CHECK(pinPage(bm, h, 1000));
+  ASSERT_EQUALS_COUNT(0, strcmp("Page-1000", h->data), "page kept across the resize");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  // the pages written through the mapped arena reached the file
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  CHECK(pinPage(bm, h, 777));
+  ASSERT_EQUALS_COUNT(0, strcmp("Page-777", h->data), "page written back");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// a pin of the blocking pin test, run in its own thread
+typedef struct BlockedPinArgs {
+  BM_BufferPool *bm;
+  BM_PageHandle page;
+  PageNumber pageNum;
+  RC status;
+} BlockedPinArgs;
+
+void *
+blockedPinWorker (void *arg)
+{
+  BlockedPinArgs *args = arg;
+  args->status = pinPage(args->bm, &args->page, args->pageNum);
+  return NULL;
+}
+
+// with pinTimeoutMillis a pin on a full pool waits for an unpin instead of failing
+void
+testBlockingPin (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle pinned[2];
+  BM_PoolOptions options;
+  BM_PoolStats stats;
+  BlockedPinArgs args;
+  pthread_t thread;
+  testName = "Testing blocking pins";
+
+  memset(&options, 0, sizeof(BM_PoolOptions));
+  options.pinTimeoutMillis = 50;
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 4);
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 2, RS_FIFO, NULL, &options));
+  CHECK(pinPage(bm, &pinned[0], 0));
+  CHECK(pinPage(bm, &pinned[1], 1));
+
+  // nobody unpins: the pin gives up after the timeout
+  args.bm = bm;
+  args.pageNum = 2;
+  blockedPinWorker(&args);
+  ASSERT_EQUALS_COUNT(RC_BUFFERPOOL_FULL, args.status, "pin times out");
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(1, (int) stats.blockedPins, "blocked pin counted");
+  ASSERT_EQUALS_COUNT(1, (int) stats.pinTimeouts, "timeout counted");
+  ASSERT_EQUALS_COUNT(1, (int) stats.pinFailures, "timeout is a failed pin");
+  ASSERT_EQUALS_COUNT(1, stats.blockedNanos >= 40 * 1000 * 1000LL, "waited for the timeout");
+  CHECK(unpinPage(bm, &pinned[0]));
+  CHECK(unpinPage(bm, &pinned[1]));
+  CHECK(shutdownBufferPool(bm));
+
+  // an unpin during the wait hands the frame to the waiting pin
+  options.pinTimeoutMillis = 10000;
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 2, RS_FIFO, NULL, &options));
+  CHECK(pinPage(bm, &pinned[0], 0));
+  CHECK(pinPage(bm, &pinned[1], 1));
+  args.pageNum = 3;
+  args.status = RC_ERROR;
+  pthread_create(&thread, NULL, blockedPinWorker, &args);
+  usleep(50 * 1000);
+  CHECK(unpinPage(bm, &pinned[0]));
+  pthread_join(thread, NULL);
+  ASSERT_EQUALS_COUNT(RC_OK, args.status, "waiting pin succeeds");
+  ASSERT_EQUALS_COUNT(0, strcmp("Page-3", args.page.data), "waiting pin reads its page");
+  ASSERT_EQUALS_POOL("[3 1],[1 1]", bm, "unpinned frame replaced");
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(0, (int) stats.pinTimeouts, "no timeout");
+  ASSERT_EQUALS_COUNT(0, (int) stats.pinFailures, "no failed pin");
+  ASSERT_EQUALS_COUNT(1, (int) stats.blockedPins, "blocked pin counted");
+  ASSERT_EQUALS_COUNT(0, (int) stats.hits, "no hits");
+  ASSERT_EQUALS_COUNT(3, (int) stats.misses, "three misses");
+  CHECK(unpinPage(bm, &args.page));
+  CHECK(unpinPage(bm, &pinned[1]));
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// with warmRestart a pool lists its resident pages at shutdown and the next pool on
+// the file prefetches them
+void
+testWarmRestart (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options;
+  BM_PoolStats stats;
+  PageNumber warmList[] = { 5, 42, 49 };
+  char expected[32];
+  int i, waited;
+  testName = "Testing warm restart";
+
+  memset(&options, 0, sizeof(BM_PoolOptions));
+  options.warmRestart = TRUE;
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 50);
+
+  // pages 5 and 7 evict 40 and 41, leaving 42..49, 5 and 7 resident
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 10, RS_LRU, NULL, &options));
+  for (i = 40; i < 50; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(pinPage(bm, h, 5));
+  CHECK(unpinPage(bm, h));
+  CHECK(pinPage(bm, h, 7));
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 10, RS_LRU, NULL, &options));
+  for (waited = 0; getPoolStats(bm).prefetchLoads < 10 && waited < 1000; waited++)
+    usleep(1000);
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(10, (int) stats.warmPages, "warm pages queued");
+  ASSERT_EQUALS_COUNT(10, (int) stats.prefetchLoads, "warm pages loaded");
+  for (i = 0; i < 3; i++)
+    {
+      CHECK(pinPage(bm, h, warmList[i]));
+      sprintf(expected, "%s-%i", "Page", warmList[i]);
+      ASSERT_EQUALS_COUNT(0, strcmp(expected, h->data), "warm page content");
+      CHECK(unpinPage(bm, h));
+    }
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(3, (int) stats.hits, "pins of warm pages are hits");
+  ASSERT_EQUALS_COUNT(0, (int) stats.misses, "no misses");
+  CHECK(shutdownBufferPool(bm));
+  ASSERT_EQUALS_COUNT(0, remove("testbuffer.bin" BM_WARM_SUFFIX), "warm file written");
+
+  // without the option no warm file is written
+  CHECK(initBufferPool(bm, "testbuffer.bin", 10, RS_LRU, NULL));
+  CHECK(pinPage(bm, h, 1));
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+  ASSERT_EQUALS_COUNT(1, fopen("testbuffer.bin" BM_WARM_SUFFIX, "rb") == NULL, "no warm file");
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// pin pages 0-2 five times each and scan pages 10-29 once on a 4-frame LRU pool, then
+// return how many of the hot pages are still buffered
+int
+scanAfterHotPages (BM_BufferPool *bm, BM_PoolOptions *options)
+{
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolStats stats;
+  int i, j;
+
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_LRU, NULL, options));
+  for (i = 0; i < 5; i++)
+    for (j = 0; j < 3; j++)
+      {
+        CHECK(pinPage(bm, h, j));
+        CHECK(unpinPage(bm, h));
+      }
+  for (i = 10; i < 30; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+
+  stats = getPoolStats(bm);
+  for (j = 0; j < 3; j++)
+    {
+      CHECK(pinPage(bm, h, j));
+      CHECK(unpinPage(bm, h));
+    }
+  i = (int) (getPoolStats(bm).hits - stats.hits);
+
+  free(h);
+  return i;
+}
+
+// the admission filter keeps a scan of one-time pages from evicting frequently pinned pages
+void
+testAdmissionFilter (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PoolOptions options;
+  BM_PoolStats stats;
+  testName = "Testing TinyLFU admission filter";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 30);
+
+  // plain LRU: the scan replaces the hot pages
+  memset(&options, 0, sizeof(BM_PoolOptions));
+  ASSERT_EQUALS_COUNT(0, scanAfterHotPages(bm, &options), "scan evicts hot pages");
+  ASSERT_EQUALS_COUNT(0, (int) getPoolStats(bm).admissionRejects, "no filter, no rejects");
+  CHECK(shutdownBufferPool(bm));
+
+  // with the filter the first scan page fills the free frame and the others replace it
+  options.admissionFilter = TRUE;
+  ASSERT_EQUALS_COUNT(3, scanAfterHotPages(bm, &options), "hot pages survive the scan");
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(19, (int) stats.admissionRejects, "scan pages rejected");
+  ASSERT_EQUALS_COUNT(19, (int) stats.evictions, "only the probation frame is replaced");
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[29 0]", bm, "scan page recycles one frame");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// a scan of data pages evicts data pages before header and index pages, unless those
+// hold more than their protected share of the pool
+void
+testPageClasses (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options;
+  BM_PoolStats stats;
+  int i, round;
+  testName = "Testing page class eviction priorities";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 30);
+  memset(&options, 0, sizeof(BM_PoolOptions));
+
+  // first with the default share of 50%, then with 20%, less than one of four frames
+  for (round = 0; round < 2; round++)
+    {
+      options.protectedPercent = round == 0 ? 0 : 20;
+      CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_LRU, NULL, &options));
+      CHECK(pinPage(bm, h, 0));
+      CHECK(setPageClass(bm, h, BM_PAGE_HEADER));
+      CHECK(unpinPage(bm, h));
+      CHECK(pinPage(bm, h, 1));
+      CHECK(setPageClass(bm, h, BM_PAGE_INDEX_INNER));
+      ASSERT_EQUALS_COUNT(RC_ERROR, setPageClass(bm, h, BM_NUM_PAGE_CLASSES), "unknown class refused");
+      CHECK(unpinPage(bm, h));
+
+      stats = getPoolStats(bm);
+      ASSERT_EQUALS_COUNT(1, stats.classFrames[BM_PAGE_HEADER], "header page counted");
+      ASSERT_EQUALS_COUNT(1, stats.classFrames[BM_PAGE_INDEX_INNER], "inner node counted");
+      ASSERT_EQUALS_COUNT(0, stats.classFrames[BM_PAGE_DATA], "no data pages yet");
+
+      for (i = 10; i < 30; i++)
+        {
+          CHECK(pinPage(bm, h, i));
+          CHECK(unpinPage(bm, h));
+        }
+
+      stats = getPoolStats(bm);
+      if (round == 0)
+        {
+          ASSERT_EQUALS_POOL("[0 0],[1 0],[28 0],[29 0]", bm, "scan only replaces data pages");
+          ASSERT_EQUALS_COUNT(2, stats.classFrames[BM_PAGE_DATA], "two data pages");
+          ASSERT_EQUALS_COUNT(1, stats.classFrames[BM_PAGE_HEADER], "header page kept");
+        }
+      else
+        {
+          ASSERT_EQUALS_POOL("[28 0],[29 0],[26 0],[27 0]", bm, "over their share the classes are plain LRU");
+          ASSERT_EQUALS_COUNT(4, stats.classFrames[BM_PAGE_DATA], "only data pages");
+          ASSERT_EQUALS_COUNT(0, stats.classFrames[BM_PAGE_HEADER], "header page evicted");
+        }
+      CHECK(shutdownBufferPool(bm));
+    }
+
+  // with the admission filter a header page loaded last is not the probation frame, so
+  // the rejected scan pages recycle a data page's frame instead of replacing it
+  memset(&options, 0, sizeof(BM_PoolOptions));
+  options.admissionFilter = TRUE;
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_LRU, NULL, &options));
+  for (i = 0; i < 4; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      if (i == 3)
+        CHECK(setPageClass(bm, h, BM_PAGE_HEADER));
+      CHECK(unpinPage(bm, h));
+    }
+  for (i = 10; i < 30; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_POOL("[29 0],[1 0],[2 0],[3 0]", bm, "header page survives the rejected scan");
+  ASSERT_EQUALS_COUNT(1, stats.classFrames[BM_PAGE_HEADER], "header page kept with the filter");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// evicted pages are kept compressed in the victim tier and come back from there without
+// a read; pages that do not compress and pages over the budget are not kept
+void
+testVictimTier (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options;
+  BM_PoolStats stats;
+  char expected[32];
+  int i, j;
+  testName = "Testing compressed victim tier";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 20);
+  memset(&options, 0, sizeof(BM_PoolOptions));
+  options.victimTierBytes = 64 * 1024;
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_LRU, NULL, &options));
+
+  // page 1 gets zero padding between short 'Y' records, page 2 random bytes that do not compress
+  CHECK(pinPage(bm, h, 1));
+  for (i = 0; i < PAGE_SIZE; i++)
+    h->data[i] = (i % 300 < 200) ? 0 : (i % 2 ? 'Y' : (char) (i % 7));
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  CHECK(pinPage(bm, h, 2));
+  srand(7);
+  for (i = 0; i < PAGE_SIZE; i++)
+    h->data[i] = (char) rand();
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+
+  // pages 0-11 through 4 frames: the first 8 are evicted, all but page 2 into the tier
+  for (i = 0; i < 12; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(7, (int) stats.tierStores, "compressible evicted pages stored");
+  ASSERT_EQUALS_COUNT(7, stats.tierPages, "tier holds them");
+  ASSERT_EQUALS_COUNT(1, stats.tierBytes < 7 * PAGE_SIZE / 4, "pages are compressed");
+  ASSERT_EQUALS_COUNT(12, (int) stats.reads, "every page read once");
+
+  // pages 0, 1 and 3-7 come back from the tier, page 2 from the file
+  for (i = 0; i < 8; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      if (i == 1)
+        {
+          for (j = 0; j < PAGE_SIZE && h->data[j] == ((j % 300 < 200) ? 0 : (j % 2 ? 'Y' : (char) (j % 7))); j++)
+            ;
+          ASSERT_EQUALS_COUNT(PAGE_SIZE, j, "pattern page content");
+        }
+      else if (i == 2)
+        {
+          srand(7);
+          ASSERT_EQUALS_COUNT(1, h->data[0] == (char) rand(), "random page content");
+        }
+      else
+        {
+          sprintf(expected, "%s-%i", "Page", i);
+          ASSERT_EQUALS_COUNT(0, strcmp(expected, h->data), "tier page content");
+        }
+      CHECK(unpinPage(bm, h));
+    }
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(7, (int) stats.tierHits, "misses served by the tier");
+  ASSERT_EQUALS_COUNT(13, (int) stats.reads, "only page 2 read again");
+  CHECK(shutdownBufferPool(bm));
+
+  // a budget for three of these pages (about 55 bytes each with the entry header) keeps the most recently evicted ones
+  options.victimTierBytes = 180;
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_LRU, NULL, &options));
+  for (i = 10; i < 20; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(6, (int) stats.tierStores, "evicted pages stored");
+  ASSERT_EQUALS_COUNT(3, stats.tierPages, "older pages dropped");
+  ASSERT_EQUALS_COUNT(1, stats.tierBytes <= options.victimTierBytes, "tier within budget");
+  CHECK(pinPage(bm, h, 14));
+  ASSERT_EQUALS_COUNT(0, strcmp("Page-14", h->data), "recently evicted page from the tier");
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_COUNT(1, (int) getPoolStats(bm).tierHits, "tier hit");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// CLOCK gives hit pages a second chance, LRU-K evicts pages referenced only once first
+void
+testClockAndLRUK (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  int i;
+  testName = "Testing CLOCK and LRU-K";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+
+  // page 0 is hit, the hand clears its bit and replaces page 1, then page 2
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_CLOCK, NULL));
+  for (i = 0; i < 3; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(pinPage(bm, h, 0));
+  CHECK(unpinPage(bm, h));
+  CHECK(pinPage(bm, h, 3));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[0 0],[3 0],[2 0]", bm, "hit page gets a second chance");
+  CHECK(pinPage(bm, h, 4));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[0 0],[3 0],[4 0]", bm, "hand moves on to the next page");
+  CHECK(shutdownBufferPool(bm));
+
+  // pages 0 and 1 are hit, new pages only replace each other until page 4 is hit too
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU_K, NULL));
+  for (i = 0; i < 3; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  for (i = 0; i < 2; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(pinPage(bm, h, 3));
+  CHECK(unpinPage(bm, h));
+  CHECK(pinPage(bm, h, 4));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[4 0]", bm, "pages referenced once go first");
+  CHECK(pinPage(bm, h, 4));
+  CHECK(unpinPage(bm, h));
+  CHECK(pinPage(bm, h, 5));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[5 0],[1 0],[4 0]", bm, "then the least recently used");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// a pool that starts with FIFO moves to LRU-K while scans run between uses of a hot
+// set, and away from it when a new working set replaces the hot set
+void
+testAdaptivePolicy (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_BufferPool *other = MAKE_POOL();
+  BM_PoolOptions options;
+  BM_SharedPoolConfig config;
+  BM_PoolStats stats;
+  testName = "Testing adaptive policy switching";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  memset(&options, 0, sizeof(BM_PoolOptions));
+  options.adaptivePolicy = 1;
+
+  // 64 frames: every pin is simulated, an epoch is 512 pins
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 64, RS_FIFO, NULL, &options));
+  pinRounds(bm, 3, 16, 1000, 24);
+  pinRounds(bm, 30, 16, 2000, 80);
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(RS_LRU_K, stats.strategy, "scans between hot pages favour LRU-K");
+  ASSERT_EQUALS_COUNT(RS_LRU_K, bm->strategy, "handle follows the switch");
+  ASSERT_EQUALS_COUNT(1, stats.policySwitches >= 1, "strategy switched");
+
+  // 60 new pages in a loop: under LRU-K they only replace each other behind the old hot
+  // set, the other strategies keep all of them
+  pinRounds(bm, 20, 0, 10000, 60);
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(1, stats.strategy != RS_LRU_K, "new working set leaves LRU-K");
+  ASSERT_EQUALS_COUNT(stats.strategy, bm->strategy, "handle follows the second switch");
+  ASSERT_EQUALS_COUNT(1, stats.policySwitches >= 2, "strategy switched again");
+  ASSERT_EQUALS_COUNT(1, stats.hits > 0, "working set hits after the switch");
+  CHECK(shutdownBufferPool(bm));
+
+  // in a shared pool a switch caused by one handle shows in the others too
+  memset(&config, 0, sizeof(BM_SharedPoolConfig));
+  config.numPages = 64;
+  config.strategy = RS_FIFO;
+  config.options.adaptivePolicy = 1;
+  CHECK(initSharedBufferPool(&config));
+  CHECK(attachBufferPool(bm, "testbuffer.bin"));
+  CHECK(attachBufferPool(other, "testbuffer.bin"));
+  pinRounds(bm, 3, 16, 1000, 24);
+  pinRounds(bm, 30, 16, 2000, 80);
+  ASSERT_EQUALS_COUNT(RS_LRU_K, getPoolStats(bm).strategy, "shared pool switched");
+  ASSERT_EQUALS_COUNT(RS_LRU_K, other->strategy, "other handle follows the switch");
+  CHECK(shutdownBufferPool(other));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(shutdownSharedBufferPool());
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(other);
+  TEST_DONE();
+}
+
+// a miss on a full pool evicts a batch of victims and writes the dirty ones back; the
+// next misses take the freed frames without evicting
+void
+testEvictionBatch (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options;
+  BM_PoolStats stats;
+  char expected[32];
+  int i;
+  testName = "Testing batched eviction";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 20);
+  memset(&options, 0, sizeof(BM_PoolOptions));
+  options.evictionBatch = 3;
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 5, RS_FIFO, NULL, &options));
+
+  // pages 0-4 fill the pool, pages 1, 2 and 4 are updated
+  for (i = 0; i < 5; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      if (i != 0 && i != 3)
+        {
+          sprintf(h->data, "%s-%i", "Batch", i);
+          CHECK(markDirty(bm, h));
+        }
+      CHECK(unpinPage(bm, h));
+    }
+
+  CHECK(pinPage(bm, h, 5));
+  ASSERT_EQUALS_POOL("[5 1],[-1 0],[-1 0],[3 0],[4x0]", bm, "first three pages evicted at once");
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(3, (int) stats.evictions, "three evictions");
+  ASSERT_EQUALS_COUNT(2, (int) stats.dirtyEvictions, "two of them dirty");
+  ASSERT_EQUALS_COUNT(2, (int) stats.writes, "dirty victims written");
+  ASSERT_EQUALS_COUNT(1, (int) stats.victimBatches, "one batch");
+  CHECK(unpinPage(bm, h));
+
+  CHECK(pinPage(bm, h, 6));
+  CHECK(unpinPage(bm, h));
+  CHECK(pinPage(bm, h, 7));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[5 0],[6 0],[7 0],[3 0],[4x0]", bm, "free frames taken in order");
+  ASSERT_EQUALS_COUNT(3, (int) getPoolStats(bm).evictions, "no eviction for free frames");
+
+  // a pinned page stays, the batch takes the next victims in FIFO order
+  CHECK(pinPage(bm, h, 5));
+  CHECK(pinPage(bm, h, 8));
+  ASSERT_EQUALS_POOL("[5 1],[-1 0],[7 0],[8 1],[-1 0]", bm, "pinned page skipped");
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(6, (int) stats.evictions, "second batch");
+  ASSERT_EQUALS_COUNT(3, (int) stats.writes, "page 4 written");
+  ASSERT_EQUALS_COUNT(2, (int) stats.victimBatches, "two batches");
+  CHECK(unpinPage(bm, h));
+  h->pageNum = 5;
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  // the written pages hold the updates
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  for (i = 0; i < 5; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", (i != 0 && i != 3) ? "Batch" : "Page", i);
+      ASSERT_EQUALS_COUNT(0, strcmp(expected, h->data), "page content after batch write");
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// with limited set, page files cannot grow past testbuffer.bin's current size, so
+// writing a page beyond its end fails; otherwise the old limit is restored. The limit
+// also holds for a log file stdout is redirected to, so the output written so far is
+// flushed first and the few lines printed meanwhile wait in the stdio buffer
+void
+limitFileSize (bool limited)
+{
+  static struct rlimit saved;
+  struct rlimit limit;
+  struct stat fileStat;
+
+  if (limited)
+    {
+      ASSERT_TRUE(stat("testbuffer.bin", &fileStat) == 0, "page file size");
+      getrlimit(RLIMIT_FSIZE, &saved);
+      limit = saved;
+      limit.rlim_cur = fileStat.st_size;
+      fflush(stdout);
+      signal(SIGXFSZ, SIG_IGN);
+      ASSERT_TRUE(setrlimit(RLIMIT_FSIZE, &limit) == 0, "file size limited");
+    }
+  else
+    {
+      ASSERT_TRUE(setrlimit(RLIMIT_FSIZE, &saved) == 0, "file size limit restored");
+      signal(SIGXFSZ, SIG_DFL);
+    }
+}
+
+// a dirty victim that cannot be written back stays buffered and dirty, and the pin
+// that needed its frame fails; the background writer retries pages it failed to write
+void
+testWriteBackFailure (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options;
+  BM_PoolStats stats;
+  int i, waited;
+  testName = "Testing failed write-backs";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+  // page 5 is past the end of the file, writing it back has to grow the file
+  for (i = 5; i < 8; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      if (i == 5)
+        {
+          sprintf(h->data, "%s-%i", "Unwritten", i);
+          CHECK(markDirty(bm, h));
+        }
+      CHECK(unpinPage(bm, h));
+    }
+
+  limitFileSize(TRUE);
+  ASSERT_EQUALS_COUNT(RC_WRITE_FAILED, pinPage(bm, h, 8), "victim not written");
+  limitFileSize(FALSE);
+  ASSERT_EQUALS_POOL("[5x0],[6 0],[7 0]", bm, "victim still buffered and dirty");
+  ASSERT_EQUALS_COUNT(0, getNumWriteIO(bm), "no write counted");
+  ASSERT_EQUALS_COUNT(1, (int) getPoolStats(bm).pinFailures, "pin failure counted");
+
+  CHECK(pinPage(bm, h, 8));
+  ASSERT_EQUALS_POOL("[8 1],[6 0],[7 0]", bm, "victim written on retry");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  CHECK(pinPage(bm, h, 5));
+  ASSERT_EQUALS_COUNT(0, strcmp("Unwritten-5", h->data), "retried write on disk");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  // a batch whose write fails leaves all its victims in place
+  memset(&options, 0, sizeof(BM_PoolOptions));
+  options.evictionBatch = 3;
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 5, RS_FIFO, NULL, &options));
+  for (i = 10; i < 15; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      if (i < 12)
+        {
+          sprintf(h->data, "%s-%i", "Unwritten", i);
+          CHECK(markDirty(bm, h));
+        }
+      CHECK(unpinPage(bm, h));
+    }
+
+  limitFileSize(TRUE);
+  ASSERT_EQUALS_COUNT(RC_WRITE_FAILED, pinPage(bm, h, 15), "batch not written");
+  limitFileSize(FALSE);
+  ASSERT_EQUALS_POOL("[10x0],[11x0],[12 0],[13 0],[14 0]", bm, "batch victims still buffered and dirty");
+  stats = getPoolStats(bm);
+  ASSERT_EQUALS_COUNT(0, (int) stats.evictions, "no eviction counted");
+  ASSERT_EQUALS_COUNT(0, (int) stats.victimBatches, "no batch counted");
+
+  CHECK(pinPage(bm, h, 15));
+  ASSERT_EQUALS_POOL("[15 1],[-1 0],[-1 0],[13 0],[14 0]", bm, "batch written on retry");
+  ASSERT_EQUALS_COUNT(2, getNumWriteIO(bm), "both dirty victims written");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  // the background writer marks a page it failed to write dirty again and retries it
+  memset(&options, 0, sizeof(BM_PoolOptions));
+  options.dirtyHighPercent = 50;
+  options.dirtyLowPercent = 25;
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_FIFO, NULL, &options));
+  limitFileSize(TRUE);
+  for (i = 20; i < 22; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Unwritten", i);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+    }
+  usleep(50 * 1000);
+  ASSERT_EQUALS_POOL("[20x0],[21x0],[-1 0],[-1 0]", bm, "pages still dirty after failed writes");
+  ASSERT_EQUALS_COUNT(0, getNumWriteIO(bm), "no write counted");
+  limitFileSize(FALSE);
+  for (waited = 0; getNumWriteIO(bm) < 1 && waited < 1000; waited++)
+    usleep(1000);
+  ASSERT_EQUALS_POOL("[20 0],[21x0],[-1 0],[-1 0]", bm, "writer retried the lower page");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  CHECK(pinPage(bm, h, 20));
+  ASSERT_EQUALS_COUNT(0, strcmp("Unwritten-20", h->data), "writer's retry on disk");
+  CHECK(unpinPage(bm, h));
+
+  // a failed forcePage leaves the page dirty and with its own pin only
+  CHECK(pinPage(bm, h, 30));
+  sprintf(h->data, "%s-%i", "Unwritten", 30);
+  CHECK(markDirty(bm, h));
+  limitFileSize(TRUE);
+  ASSERT_EQUALS_COUNT(RC_WRITE_FAILED, forcePage(bm, h), "forced page not written");
+  limitFileSize(FALSE);
+  ASSERT_EQUALS_POOL("[20 0],[30x1],[-1 0]", bm, "forced page still dirty");
+  ASSERT_EQUALS_COUNT(0, getNumWriteIO(bm), "no write counted");
+  ASSERT_EQUALS_COUNT(0, (int) getPoolStats(bm).flushes, "no flush counted");
+  CHECK(forcePage(bm, h));
+  ASSERT_EQUALS_POOL("[20 0],[30 1],[-1 0]", bm, "force written on retry");
+  ASSERT_EQUALS_COUNT(1, getNumWriteIO(bm), "retried force counted");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// rounds of pins and unpins of hot pages 0..hotPages-1 followed by scanPages pages from
+// firstScanPage on, a new range each round if hotPages > 0 and the same range otherwise
+void
+pinRounds (BM_BufferPool *bm, int rounds, int hotPages, int firstScanPage, int scanPages)
+{
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  int round, i;
+
+  for (round = 0; round < rounds; round++)
+    {
+      for (i = 0; i < hotPages; i++)
+        {
+          CHECK(pinPage(bm, h, i));
+          CHECK(unpinPage(bm, h));
+        }
+      for (i = 0; i < scanPages; i++)
+        {
+          CHECK(pinPage(bm, h, firstScanPage + (hotPages > 0 ? round * scanPages : 0) + i));
+          CHECK(unpinPage(bm, h));
+        }
+    }
+  free(h);
+}
+
+// shared state of the optimistic read test: pages are filled with one repeated byte
+#define OPTIMISTIC_PAGES 8
+#define OPTIMISTIC_FRAMES 4
+#define OPTIMISTIC_OPS 20000
+#define OPTIMISTIC_READERS 3
+#define OPTIMISTIC_SPAN 256
+#define OPTIMISTIC_RESIZES 300
+
+typedef struct OptimisticArgs {
+  BM_BufferPool *bm;
+  unsigned int seed;
+  int errors;
+} OptimisticArgs;
+
+// readPageOptimistic copies page data without pinning, follows the page across
+// eviction and resizing, and never returns a half-written page
+void
+testOptimisticRead (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_OptimisticHandle optimistic = INIT_OPTIMISTIC_HANDLE;
+  pthread_t threads[OPTIMISTIC_READERS + 1];
+  OptimisticArgs args[OPTIMISTIC_READERS + 1];
+  char buf[PAGE_SIZE];
+  int i, t;
+  testName = "Testing optimistic reads";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+
+  CHECK(readPageOptimistic(bm, &optimistic, 4, buf, 0, 16));
+  ASSERT_EQUALS_COUNT(0, strcmp("Page-4", buf), "page read without a pin");
+  ASSERT_EQUALS_COUNT(1, getNumReadIO(bm), "missed page loaded once");
+  ASSERT_EQUALS_COUNT(0, getFixCounts(bm)[0], "page left unpinned");
+  CHECK(readPageOptimistic(bm, &optimistic, 4, buf, 5, 2));
+  ASSERT_EQUALS_COUNT('4', buf[0], "read at an offset");
+  ASSERT_EQUALS_COUNT(1, getNumReadIO(bm), "second read hits");
+
+  // a write under the exclusive latch is seen by the next read
+  CHECK(pinPageExclusive(bm, h, 4));
+  sprintf(h->data, "%s-%i", "Written", 4);
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPageLatched(bm, h));
+  CHECK(readPageOptimistic(bm, &optimistic, 4, buf, 0, 16));
+  ASSERT_EQUALS_COUNT(0, strcmp("Written-4", buf), "read sees the exclusive write");
+
+  // evict page 4, its frame now holds another page
+  for (i = 5; i < 8; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(readPageOptimistic(bm, &optimistic, 4, buf, 0, 16));
+  ASSERT_EQUALS_COUNT(0, strcmp("Written-4", buf), "evicted page read back");
+
+  CHECK(resizeBufferPool(bm, 6));
+  CHECK(readPageOptimistic(bm, &optimistic, 7, buf, 0, 16));
+  ASSERT_EQUALS_COUNT(0, strcmp("Page-7", buf), "read after resize");
+
+  ASSERT_EQUALS_COUNT(RC_ERROR, readPageOptimistic(bm, &optimistic, 1, buf, PAGE_SIZE - 4, 8), "read past the page");
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  // a writer refills pages while readers copy them optimistically
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPool(bm, "testbuffer.bin", OPTIMISTIC_FRAMES, RS_LRU, NULL));
+  for (t = 0; t <= OPTIMISTIC_READERS; t++)
+    {
+      memset(&args[t], 0, sizeof(OptimisticArgs));
+      args[t].bm = bm;
+      args[t].seed = t + 1;
+      pthread_create(&threads[t], NULL, t == 0 ? optimisticWriter : optimisticReader, &args[t]);
+    }
+  for (t = 0; t <= OPTIMISTIC_READERS; t++)
+    pthread_join(threads[t], NULL);
+  for (t = 0; t <= OPTIMISTIC_READERS; t++)
+    ASSERT_EQUALS_COUNT(0, args[t].errors, "no torn or failed reads");
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  // the pool shrinks and grows while readers copy pages optimistically; the frames
+  // and chunks a resize replaces stay valid until the readers using them are done
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPool(bm, "testbuffer.bin", OPTIMISTIC_FRAMES, RS_LRU, NULL));
+  for (t = 0; t <= OPTIMISTIC_READERS; t++)
+    {
+      memset(&args[t], 0, sizeof(OptimisticArgs));
+      args[t].bm = bm;
+      args[t].seed = t + 1;
+      pthread_create(&threads[t], NULL, t == 0 ? optimisticResizer : optimisticReader, &args[t]);
+    }
+  for (t = 0; t <= OPTIMISTIC_READERS; t++)
+    pthread_join(threads[t], NULL);
+  for (t = 0; t <= OPTIMISTIC_READERS; t++)
+    ASSERT_EQUALS_COUNT(0, args[t].errors, "no torn or failed reads during resizes");
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+void *
+optimisticWriter (void *arg)
+{
+  OptimisticArgs *args = (OptimisticArgs *) arg;
+  BM_PageHandle h;
+  int i, pageNum;
+
+  for (i = 0; i < OPTIMISTIC_OPS; i++)
+    {
+      pageNum = rand_r(&args->seed) % OPTIMISTIC_PAGES;
+      if (pinPageExclusive(args->bm, &h, pageNum) != RC_OK)
+        {
+          args->errors++;
+          continue;
+        }
+      memset(h.data, 'a' + i % 26, OPTIMISTIC_SPAN);
+      markDirty(args->bm, &h);
+      unpinPageLatched(args->bm, &h);
+    }
+
+  return NULL;
+}
+
+// cycles the pool through a shrink below and a grow beyond its initial size; a
+// shrink may find the readers' fallback pins in the way, which is not an error
+void *
+optimisticResizer (void *arg)
+{
+  OptimisticArgs *args = (OptimisticArgs *) arg;
+  int sizes[] = { 2, OPTIMISTIC_FRAMES, 2 * OPTIMISTIC_FRAMES };
+  int i;
+  RC rc;
+
+  for (i = 0; i < OPTIMISTIC_RESIZES; i++)
+    {
+      rc = resizeBufferPool(args->bm, sizes[i % 3]);
+      if (rc != RC_OK && rc != RC_BUFFERPOOL_IN_USE)
+        args->errors++;
+    }
+
+  return NULL;
+}
+
+void *
+optimisticReader (void *arg)
+{
+  OptimisticArgs *args = (OptimisticArgs *) arg;
+  BM_OptimisticHandle optimistic = INIT_OPTIMISTIC_HANDLE;
+  char buf[OPTIMISTIC_SPAN];
+  int *fixCounts;
+  int i, j, pageNum, snapshots;
+
+  snapshots = args->seed == 2;
+  for (i = 0; i < OPTIMISTIC_OPS; i++)
+    {
+      pageNum = rand_r(&args->seed) % OPTIMISTIC_PAGES;
+      if (readPageOptimistic(args->bm, &optimistic, pageNum, buf, 0, OPTIMISTIC_SPAN) != RC_OK)
+        {
+          args->errors++;
+          continue;
+        }
+      for (j = 1; j < OPTIMISTIC_SPAN; j++)
+        if (buf[j] != buf[0])
+          {
+            args->errors++;
+            break;
+          }
+
+      // one reader also takes snapshots of the frames, which must not see a resize
+      // halfway
+      if (snapshots && i % 64 == 0)
+        {
+          fixCounts = getFixCounts(args->bm);
+          getFrameContents(args->bm);
+          getDirtyFlags(args->bm);
+          if (fixCounts[0] < 0 || fixCounts[0] > OPTIMISTIC_READERS)
+            args->errors++;
+        }
+    }
+
+  return NULL;
+}
+
+// shared state of the concurrent pin test
+#define CONCURRENT_THREADS 8
+#define CONCURRENT_PAGES 64
+#define CONCURRENT_FRAMES 16
+#define CONCURRENT_OPS 20000
+#define COUNTER_OFFSET 64
+
+typedef struct ConcurrentPinArgs {
+  BM_BufferPool *bm;
+  unsigned int seed;
+  int increments[CONCURRENT_PAGES];
+  int errors;
+} ConcurrentPinArgs;
+
+// threads pin random pages through a pool smaller than the page set: readers
+// check the page they got, writers bump a per-page counter under the exclusive latch
+void
+testConcurrentPins (int numPartitions)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  pthread_t threads[CONCURRENT_THREADS];
+  ConcurrentPinArgs args[CONCURRENT_THREADS];
+  BM_PoolOptions options = { numPartitions };
+  int expected, i, t;
+  testName = "Testing concurrent shared and exclusive pins";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, CONCURRENT_PAGES);
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", CONCURRENT_FRAMES, RS_LRU, NULL, &options));
+
+  for (t = 0; t < CONCURRENT_THREADS; t++)
+    {
+      memset(&args[t], 0, sizeof(ConcurrentPinArgs));
+      args[t].bm = bm;
+      args[t].seed = t + 1;
+      pthread_create(&threads[t], NULL, concurrentPinWorker, &args[t]);
+    }
+  for (t = 0; t < CONCURRENT_THREADS; t++)
+    pthread_join(threads[t], NULL);
+
+  for (t = 0; t < CONCURRENT_THREADS; t++)
+    ASSERT_EQUALS_COUNT(0, args[t].errors, "worker saw the page it pinned");
+  CHECK(shutdownBufferPool(bm));
+
+  // every increment survived eviction and write-back
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  for (i = 0; i < CONCURRENT_PAGES; i++)
+    {
+      expected = 0;
+      for (t = 0; t < CONCURRENT_THREADS; t++)
+        expected += args[t].increments[i];
+      CHECK(pinPage(bm, h, i));
+      ASSERT_EQUALS_COUNT(expected, *(int *) (h->data + COUNTER_OFFSET), "no lost updates on page");
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+void *
+concurrentPinWorker (void *arg)
+{
+  ConcurrentPinArgs *args = (ConcurrentPinArgs *) arg;
+  BM_PageHandle h;
+  char expected[32];
+  int i, pageNum;
+
+  for (i = 0; i < CONCURRENT_OPS; i++)
+    {
+      pageNum = rand_r(&args->seed) % CONCURRENT_PAGES;
+      sprintf(expected, "%s-%i", "Page", pageNum);
+
+      if (rand_r(&args->seed) % 4 == 0)
+        {
+          if (pinPageExclusive(args->bm, &h, pageNum) != RC_OK)
+            {
+              args->errors++;
+              continue;
+            }
+          (*(int *) (h.data + COUNTER_OFFSET))++;
+          args->increments[pageNum]++;
+          markDirty(args->bm, &h);
+        }
+      else if (pinPageShared(args->bm, &h, pageNum) != RC_OK)
+        {
+          args->errors++;
+          continue;
+        }
+
+      if (h.pageNum != pageNum || strcmp(expected, h.data) != 0)
+        args->errors++;
+      unpinPageLatched(args->bm, &h);
+    }
+
+  return NULL;
+}
+
+// shared state of the concurrent load test
+#define LOAD_THREADS 4
+#define LOAD_PAGES 32
+#define LOAD_ROUNDS 20
+
+typedef struct ConcurrentLoadArgs {
+  BM_BufferPool *bm;
+  pthread_barrier_t *start;
+  int errors;
+} ConcurrentLoadArgs;
+
+// threads start together and pin the same unbuffered pages: a pin that finds its
+// page still being read must wait for it instead of reading it again
+void
+testConcurrentLoads (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  pthread_t threads[LOAD_THREADS];
+  ConcurrentLoadArgs args[LOAD_THREADS];
+  pthread_barrier_t start;
+  BM_PoolOptions options = { 2 };
+  int errors = 0, extraReads = 0;
+  int round, t;
+  testName = "Testing concurrent loads of a page";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, LOAD_PAGES);
+
+  for (round = 0; round < LOAD_ROUNDS; round++)
+    {
+      CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", LOAD_PAGES, RS_LRU, NULL, &options));
+      pthread_barrier_init(&start, NULL, LOAD_THREADS);
+      for (t = 0; t < LOAD_THREADS; t++)
+        {
+          args[t].bm = bm;
+          args[t].start = &start;
+          args[t].errors = 0;
+          pthread_create(&threads[t], NULL, concurrentLoadWorker, &args[t]);
+        }
+      for (t = 0; t < LOAD_THREADS; t++)
+        {
+          pthread_join(threads[t], NULL);
+          errors += args[t].errors;
+        }
+      pthread_barrier_destroy(&start);
+      extraReads += getNumReadIO(bm) - LOAD_PAGES;
+      CHECK(shutdownBufferPool(bm));
+    }
+
+  ASSERT_EQUALS_INT(0, errors, "every pin saw its page after the read");
+  ASSERT_EQUALS_INT(0, extraReads, "each page was read once");
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  TEST_DONE();
+}
+
+void *
+concurrentLoadWorker (void *arg)
+{
+  ConcurrentLoadArgs *args = (ConcurrentLoadArgs *) arg;
+  BM_PageHandle h;
+  char expected[32];
+  int pageNum;
+
+  pthread_barrier_wait(args->start);
+  for (pageNum = 0; pageNum < LOAD_PAGES; pageNum++)
+    {
+      sprintf(expected, "%s-%i", "Page", pageNum);
+      if (pinPage(args->bm, &h, pageNum) != RC_OK)
+        {
+          args->errors++;
+          continue;
+        }
+      if (h.pageNum != pageNum || strcmp(expected, h.data) != 0)
+        args->errors++;
+      unpinPage(args->bm, &h);
+    }
+
+  return NULL;
+}